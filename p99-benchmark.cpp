@@ -0,0 +1,303 @@
+#include <chrono>
+#include <random>
+#include "p99.cpp"
+
+size_t blackHole = 0;
+
+template<typename F>
+double secondsToRun(F f) {
+    blackHole += f(); // warm up
+    auto start = std::chrono::steady_clock::now();
+    blackHole += f();
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    return duration.count();
+}
+
+template<typename F>
+void measure(const std::string &name, F f) {
+    std::cout << name << ": " << secondsToRun(f) * 1000 << "ms\n";
+}
+
+template<typename F>
+void measureThroughput(const std::string &name, size_t bytes, F f) {
+    double seconds = secondsToRun(f);
+    std::cout << name << ": " << seconds * 1000 << "ms, " << bytes / seconds / 1e9 << " GB/s\n";
+}
+
+Vector<int> runsOfRandomLength(size_t size, int maxRunLength) {
+    std::mt19937 random(123);
+    Vector<int> result;
+    result.reserve(size);
+    int value = 0;
+    while (result.size() < size) {
+        size_t runLength = std::min(size - result.size(), (size_t) (random() % maxRunLength + 1));
+        result.insert(result.end(), runLength, value++);
+    }
+    return result;
+}
+
+template<typename Sequence>
+void listAlgorithmsBenchmark(const std::string &kind, const Sequence &sequence) {
+    int size = (int) sequence.size();
+    measure("compress " + kind, [&]{ return compress(sequence).size(); });
+    measure("pack " + kind, [&]{ return pack(sequence).size(); });
+    measure("encode " + kind, [&]{ return encode(sequence).size(); });
+    measure("encodeDirect " + kind, [&]{ return encodeDirect(sequence).size(); });
+    measure("decode " + kind, [&]{ return decode(encodeDirect(sequence)).size(); });
+    measure("duplicateN " + kind, [&]{ return duplicateN(3, sequence).size(); });
+    measure("dropEvery " + kind, [&]{ return dropEvery(3, sequence).size(); });
+    measure("split " + kind, [&]{ return std::get<1>(split(size / 2, sequence)).size(); });
+    measure("slice " + kind, [&]{ return slice(size / 4, size / 2, sequence).size(); });
+    measure("rotate " + kind, [&]{ return rotate(size / 3, sequence).size(); });
+    measure("removeAt " + kind, [&]{ return std::get<0>(removeAt(size / 2, sequence)).size(); });
+    measure("insertAt " + kind, [&]{ return insertAt(size / 2, 42, sequence).size(); });
+}
+
+void listVsVectorBenchmark() {
+    auto vector = runsOfRandomLength(4000000, 8);
+    List<int> list(vector.begin(), vector.end());
+    listAlgorithmsBenchmark("List", list);
+    listAlgorithmsBenchmark("Vector", vector);
+}
+
+template<typename T>
+void runBoundariesBenchmark(const std::string &kind, int maxRunLength) {
+    auto ints = runsOfRandomLength(64 * 1024 * 1024 / sizeof(T), maxRunLength);
+    Vector<T> vector(ints.begin(), ints.end());
+    size_t bytes = vector.size() * sizeof(T);
+    std::string suffix = " " + kind + " runs<=" + std::to_string(maxRunLength);
+    measureThroughput("compress generic" + suffix, bytes, [&]{ return compress<Vector<T>>(vector).size(); });
+    measureThroughput("compress vectorized" + suffix, bytes, [&]{ return compress(vector).size(); });
+    measureThroughput("encodeDirect generic" + suffix, bytes, [&]{ return encodeDirect<Vector<T>>(vector).size(); });
+    measureThroughput("encodeDirect vectorized" + suffix, bytes, [&]{ return encodeDirect(vector).size(); });
+}
+
+void vectorizedRunBoundariesBenchmark() {
+    for (int maxRunLength : {4, 64, 1024}) {
+        runBoundariesBenchmark<uint8_t>("uint8_t", maxRunLength);
+        runBoundariesBenchmark<int>("int", maxRunLength);
+    }
+}
+
+void parallelEncodingBenchmark() {
+    auto ints = runsOfRandomLength(128 * 1024 * 1024, 16);
+    Vector<uint8_t> vector(ints.begin(), ints.end());
+    measureThroughput("encodeDirect", vector.size(), [&]{ return encodeDirect(vector).size(); });
+    for (unsigned threadCount = 1; threadCount <= defaultThreadCount(); threadCount *= 2) {
+        measureThroughput("encodeDirectParallel threads=" + std::to_string(threadCount), vector.size(), [&]{
+            return encodeDirectParallel(vector, threadCount).size();
+        });
+    }
+}
+
+void parallelDecodingBenchmark() {
+    auto encoded = encode(runsOfRandomLength(128 * 1024 * 1024, 16));
+    auto vector = runsOfRandomLength(32 * 1024 * 1024, 1);
+    size_t decodedBytes = decode(encoded).size() * sizeof(int);
+    measureThroughput("decode", decodedBytes, [&]{ return decode(encoded).size(); });
+    measureThroughput("duplicateN", vector.size() * 4 * sizeof(int), [&]{ return duplicateN(4, vector).size(); });
+    for (unsigned threadCount = 1; threadCount <= defaultThreadCount(); threadCount *= 2) {
+        std::string suffix = " threads=" + std::to_string(threadCount);
+        measureThroughput("decodeParallel" + suffix, decodedBytes, [&]{ return decodeParallel(encoded, threadCount).size(); });
+        measureThroughput("duplicateNParallel" + suffix, vector.size() * 4 * sizeof(int), [&]{
+            return duplicateNParallel(4, vector, threadCount).size();
+        });
+    }
+}
+
+void parallelShuffleBenchmark() {
+    Vector<int> vector(10000000);
+    std::iota(vector.begin(), vector.end(), 0);
+    measure("randomPermute", [&]{ return randomPermute(123, vector).size(); });
+    for (unsigned threadCount = 1; threadCount <= defaultThreadCount(); threadCount *= 2) {
+        measure("randomPermuteParallel threads=" + std::to_string(threadCount), [&]{
+            return randomPermuteParallel(123, vector, threadCount).size();
+        });
+    }
+}
+
+void batchLottoBenchmark() {
+    size_t drawCount = 10000000;
+    auto report = [&](const std::string &name, double seconds) {
+        std::cout << name << ": " << seconds * 1000 << "ms, " << drawCount / seconds / 1e6 << "M draws/s\n";
+    };
+    report("lotto", secondsToRun([&]{
+        size_t size = 0;
+        Xoshiro256 random(123);
+        for (size_t i = 0; i < drawCount; i++) size += lotto(random, 6, 49).size();
+        return size;
+    }));
+    for (unsigned threadCount = 1; threadCount <= defaultThreadCount(); threadCount *= 2) {
+        report("lottoBatch threads=" + std::to_string(threadCount), secondsToRun([&]{
+            return lottoBatch(123, drawCount, 6, 49, threadCount).size();
+        }));
+    }
+}
+
+void sortByLengthBenchmark() {
+    std::mt19937 random(123);
+    List<List<int>> lists;
+    for (int i = 0; i < 1000000; i++) {
+        lists.push_back(List<int>(random() % 16, i));
+    }
+    measure("sortByLength comparison sort", [&]{
+        List<List<int>> result = lists;
+        result.sort([](const List<int> &list1, const List<int> &list2) { return list1.size() < list2.size(); });
+        return result.size();
+    });
+    measure("sortByLength", [&]{ return sortByLength(lists).size(); });
+    measure("sortByLengthFrequency comparison sort", [&]{
+        std::unordered_map<size_t, int> frequencyByLength;
+        for (auto &list : lists) frequencyByLength[list.size()]++;
+        List<List<int>> result = lists;
+        result.sort([&](const List<int> &list1, const List<int> &list2) {
+            return frequencyByLength[list1.size()] < frequencyByLength[list2.size()];
+        });
+        return result.size();
+    });
+    measure("sortByLengthFrequency", [&]{ return sortByLengthFrequency(lists).size(); });
+}
+
+void flattenBenchmark() {
+    std::mt19937 random(123);
+    List<List<int>> lists;
+    for (int i = 0; i < 2000000; i++) {
+        lists.push_back(List<int>(random() % 8, i));
+    }
+    Vector<Vector<int>> vectors;
+    for (auto &list : lists) vectors.emplace_back(list.begin(), list.end());
+
+    measure("flatten", [&]{ return flatten(lists).size(); });
+    measure("copy + flatten rvalue", [&]{
+        List<List<int>> listsCopy = lists;
+        return flatten(std::move(listsCopy)).size();
+    });
+    for (unsigned threadCount = 1; threadCount <= defaultThreadCount(); threadCount *= 2) {
+        measure("flattenParallel threads=" + std::to_string(threadCount), [&]{
+            return flattenParallel(vectors, threadCount).size();
+        });
+    }
+}
+
+void primeSieveBenchmark() {
+    for (unsigned threadCount = 1; threadCount <= defaultThreadCount(); threadCount *= 2) {
+        std::string suffix = " threads=" + std::to_string(threadCount);
+        measure("forEachPrimeInRange [0, 10^8]" + suffix, [&]{
+            size_t count = 0;
+            forEachPrimeInRange(0, 100000000, [&](uint64_t) { count++; }, threadCount);
+            return count;
+        });
+        measure("forEachPrimeInRange [10^12 - 10^8, 10^12]" + suffix, [&]{
+            size_t count = 0;
+            forEachPrimeInRange(1000000000000ull - 100000000, 1000000000000ull, [&](uint64_t) { count++; }, threadCount);
+            return count;
+        });
+    }
+    measure("listPrimesInRange [0, 10^7]", [&]{ return listPrimesInRange(0, 10000000).size(); });
+}
+
+void millerRabinBenchmark() {
+    Xoshiro256 random(123);
+    Vector<uint64_t> candidates(1000000);
+    for (auto &candidate : candidates) candidate = random() | 1;
+    measure("isPrime64", [&]{
+        size_t count = 0;
+        for (uint64_t candidate : candidates) count += isPrime64(candidate);
+        return count;
+    });
+    measure("isPrime64 batch", [&]{
+        auto results = isPrime64(candidates);
+        return (size_t) std::count(results.begin(), results.end(), true);
+    });
+}
+
+void factorizationBenchmark() {
+    Vector<uint64_t> primes;
+    forEachPrimeInRange(4000000000ull, 4000010000ull, [&](uint64_t prime) { primes.push_back(prime); });
+    Vector<uint64_t> semiprimes;
+    for (size_t i = 0; i + 1 < primes.size() && semiprimes.size() < 1000; i += 2) {
+        semiprimes.push_back(primes[i] * primes[i + 1]);
+    }
+    double seconds = secondsToRun([&]{
+        size_t count = 0;
+        for (uint64_t n : semiprimes) count += primeFactorsOf64(n).size();
+        return count;
+    });
+    std::cout << "primeFactorsOf64 semiprimes: " << seconds / semiprimes.size() * 1e6 << "us per number\n";
+}
+
+void smallestPrimeFactorTableBenchmark() {
+    const uint32_t limit = 100000000;
+    for (unsigned threadCount = 1; threadCount <= defaultThreadCount(); threadCount *= 2) {
+        measure("SmallestPrimeFactorTable 10^8 threads=" + std::to_string(threadCount), [&]{
+            return SmallestPrimeFactorTable(limit, threadCount).memoryBytes();
+        });
+    }
+    SmallestPrimeFactorTable table(limit, defaultThreadCount());
+    std::cout << "SmallestPrimeFactorTable 10^8 memory: " << table.memoryBytes() / 1e6 << "MB\n";
+
+    Xoshiro256 random(123);
+    Vector<uint32_t> numbers(10000000);
+    for (auto &n : numbers) n = (uint32_t) randomBelow(limit, random) + 1;
+    measure("SmallestPrimeFactorTable 10^7 totients", [&]{
+        uint64_t sum = 0;
+        for (uint32_t n : numbers) sum += table.totient(n);
+        return sum;
+    });
+    measure("SmallestPrimeFactorTable 10^7 factorizations", [&]{
+        uint32_t factors[32];
+        size_t count = 0;
+        for (uint32_t n : numbers) count += table.primeFactorsOf(n, factors);
+        return count;
+    });
+}
+
+void totientSieveBenchmark() {
+    for (unsigned threadCount = 1; threadCount <= defaultThreadCount(); threadCount *= 2) {
+        std::string suffix = " threads=" + std::to_string(threadCount);
+        measure("totientsUpTo 10^8" + suffix, [&]{ return totientsUpTo(100000000, threadCount).size(); });
+        measure("totientsInRange [0, 10^8]" + suffix, [&]{ return totientsInRange(0, 100000000, threadCount).size(); });
+    }
+}
+
+template<typename F>
+void heapVsArenaBenchmark(const std::string &name, F f) {
+    measure(name + " heap", [&]{ return f(std::pmr::new_delete_resource()); });
+    measure(name + " monotonic arena", [&]{
+        std::pmr::monotonic_buffer_resource arena;
+        return f(&arena);
+    });
+}
+
+void memoryResourceBenchmark() {
+    heapVsArenaBenchmark("pack", [](std::pmr::memory_resource *resource) {
+        std::pmr::list<int> list(resource);
+        for (int item : runsOfRandomLength(1000000, 8)) list.push_back(item);
+        return pack(list).size();
+    });
+    heapVsArenaBenchmark("combinations", [](std::pmr::memory_resource *resource) {
+        return combinations(3, range(1, 60, resource)).size();
+    });
+    heapVsArenaBenchmark("group", [](std::pmr::memory_resource *resource) {
+        return group((List<int>) {3, 3, 3}, range(1, 9, resource)).size();
+    });
+}
+
+int main() {
+    listVsVectorBenchmark();
+    vectorizedRunBoundariesBenchmark();
+    parallelEncodingBenchmark();
+    parallelDecodingBenchmark();
+    parallelShuffleBenchmark();
+    batchLottoBenchmark();
+    sortByLengthBenchmark();
+    memoryResourceBenchmark();
+    flattenBenchmark();
+    primeSieveBenchmark();
+    millerRabinBenchmark();
+    factorizationBenchmark();
+    smallestPrimeFactorTableBenchmark();
+    totientSieveBenchmark();
+    std::cout << "(" << blackHole << ")\n";
+    return 0;
+}
@@ -23,10 +23,27 @@ TEST(P3, FindNthElementOfList) {
     EXPECT_EQ(8, getElement(5, list));
 }
 
+TEST(P3, PositionalAccessScalesToTenMillionElements) {
+    for (int size = 10; size <= 10000000; size *= 10) {
+        Vector<int> vector(size);
+        std::iota(vector.begin(), vector.end(), 0);
+
+        EXPECT_EQ(size, sizeOf(vector));
+        for (int position = 0; position < size; position += size / 10) {
+            EXPECT_EQ(position, getElement(position, vector));
+        }
+        EXPECT_EQ(size - 2, penultimate(vector));
+        EXPECT_EQ(size / 2 + 1, getElement(size / 2, std::get<0>(removeAt(size / 2, vector))));
+        EXPECT_EQ(-1, getElement(size / 2, insertAt(size / 2, -1, vector)));
+        EXPECT_EQ(size / 3, getElement(0, rotate(size / 3, vector)));
+    }
+}
+
 TEST(P4, NumberOfElementsInList) {
     EXPECT_EQ(0, sizeOf((List<int>) {}));
     EXPECT_EQ(1, sizeOf((List<int>) {1}));
     EXPECT_EQ(6, sizeOf((List<int>) {1, 1, 2, 3, 5, 8}));
+    EXPECT_EQ(6, sizeOf((Vector<int>) {1, 1, 2, 3, 5, 8}));
 }
 
 TEST(P5, ReverseList) {
@@ -52,6 +69,29 @@ TEST(P7, FlattenList) {
     EXPECT_EQ((List<int>) {1}, flatten((List<List<int>>) {{1}}));
     List<int> expected = {1, 2, 3, 4};
     EXPECT_EQ(expected, flatten((List<List<int>>) {{1, 2}, {3, 4}}));
+
+    expected = {3, 1, 4, 2};
+    List<List<int>> unsorted = {{3}, {}, {1, 4}, {2}};
+    EXPECT_EQ(expected, flatten(unsorted));
+    EXPECT_EQ(expected, flatten(std::move(unsorted)));
+}
+
+TEST(P7, ParallelFlatten) {
+    Vector<List<int>> lists;
+    Vector<int> expected;
+    for (int i = 0; i < 1000; i++) {
+        lists.push_back(range(i, i + i % 7 - 1));
+        expected.insert(expected.end(), lists.back().begin(), lists.back().end());
+    }
+    Vector<Vector<int>> vectors;
+    for (auto &list : lists) vectors.emplace_back(list.begin(), list.end());
+
+    for (unsigned threadCount : {1, 2, 3, 8}) {
+        EXPECT_EQ(expected, flattenParallel(lists, threadCount));
+        EXPECT_EQ(expected, flattenParallel(vectors, threadCount));
+    }
+    EXPECT_EQ(Vector<int>(), flattenParallel(Vector<Vector<int>>(), 4));
+    EXPECT_EQ(Vector<int>(), flattenParallel(Vector<Vector<int>>(3), 4));
 }
 
 TEST(P8, CompressList) {
@@ -62,6 +102,44 @@ TEST(P8, CompressList) {
     List<char> expected = {'a', 'b', 'c', 'a', 'd', 'e'};
     List<char> actual = compress((List<char>){'a', 'a', 'a', 'a', 'b', 'c', 'c', 'a', 'a', 'd', 'e', 'e', 'e', 'e'});
     EXPECT_EQ(expected, actual);
+
+    Vector<char> expectedVector = {'a', 'b', 'c', 'a'};
+    EXPECT_EQ(expectedVector, compress((Vector<char>) {'a', 'a', 'b', 'c', 'c', 'a'}));
+
+    Vector<bool> expectedBits = {true, false, true};
+    EXPECT_EQ(expectedBits, compress((Vector<bool>) {true, true, false, true, true}));
+}
+
+template<typename T>
+void expectSameRunsAsGenericImplementation(int maxRunLength) {
+    srand(123);
+    for (int size : {0, 1, 2, 15, 16, 17, 31, 33, 64, 1023, 1024, 1025, 5000}) {
+        Vector<T> vector;
+        while (sizeOf(vector) < size) {
+            vector.insert(vector.end(), std::min(size - sizeOf(vector), rand() % maxRunLength + 1), (T) rand());
+        }
+        EXPECT_EQ(compress<Vector<T>>(vector), compress(vector));
+        EXPECT_EQ(pack<Vector<T>>(vector), pack(vector));
+        EXPECT_EQ(encodeDirect<Vector<T>>(vector), encodeDirect(vector));
+    }
+}
+
+TEST(P8, VectorizedRunBoundaries) {
+    for (int maxRunLength : {1, 3, 40}) {
+        expectSameRunsAsGenericImplementation<char>(maxRunLength);
+        expectSameRunsAsGenericImplementation<uint8_t>(maxRunLength);
+        expectSameRunsAsGenericImplementation<int>(maxRunLength);
+        expectSameRunsAsGenericImplementation<long>(maxRunLength);
+        expectSameRunsAsGenericImplementation<bool>(maxRunLength);
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    Vector<uint8_t> bytes = {1, 1, 2, 2, 2, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 5};
+    size_t expected[64], actual[64];
+    size_t expectedCount = scalarRunBoundariesOf(bytes.data(), 1, bytes.size(), expected);
+    EXPECT_EQ(expectedCount, sse2RunBoundariesOf(bytes.data(), 1, bytes.size(), actual));
+    EXPECT_TRUE(std::equal(expected, expected + expectedCount, actual));
+#endif
 }
 
 TEST(P9, PackList) {
@@ -75,6 +153,10 @@ TEST(P9, PackList) {
     expected = {{'a', 'a', 'a', 'a'}, {'b'}, {'c', 'c'}, {'a', 'a'}, {'d'}, {'e', 'e', 'e', 'e'}};
     actual = pack((List<char>) {'a', 'a', 'a', 'a', 'b', 'c', 'c', 'a', 'a', 'd', 'e', 'e', 'e', 'e'});
     EXPECT_EQ(expected, actual);
+
+    EXPECT_EQ((Vector<Vector<char>>) {}, pack((Vector<char>) {}));
+    Vector<Vector<char>> expectedVector = {{'a', 'a'}, {'b'}, {'a'}};
+    EXPECT_EQ(expectedVector, pack((Vector<char>) {'a', 'a', 'b', 'a'}));
 }
 
 TEST(P10, RunLengthEncodingOfAList) {
@@ -87,6 +169,9 @@ TEST(P10, RunLengthEncodingOfAList) {
     expected = {pair(2, 'a')};
     actual = encode((List<char>) {'a', 'a'});
     EXPECT_EQ(expected, actual);
+
+    Vector<Tuple<int, char>> expectedVector = {pair(2, 'a'), pair(1, 'b')};
+    EXPECT_EQ(expectedVector, encode((Vector<char>) {'a', 'a', 'b'}));
 }
 
 TEST(P11, ModifiedRunLengthEncodingOfAList) {
@@ -105,6 +190,24 @@ TEST(P11, ModifiedRunLengthEncodingOfAList) {
 TEST(P12, DecodeRunLengthEncodedAList) {
     EXPECT_EQ((List<char>) {}, decode((List<Tuple<int, char>>) {}));
     EXPECT_EQ((List<char>) {'a'}, decode((List<Tuple<int, char>>) { pair(1, 'a') }));
+    Vector<char> expectedVector = {'a', 'a', 'b'};
+    EXPECT_EQ(expectedVector, decode((Vector<Tuple<int, char>>) { pair(2, 'a'), pair(1, 'b') }));
+
+    Vector<Tuple<int, char>> negativeCount = {pair(2, 'a'), pair(-1, 'c'), pair(1, 'b')};
+    EXPECT_EQ(expectedVector, decode(negativeCount));
+    EXPECT_EQ(expectedVector, (decode<Vector<Tuple<int, char>>>(negativeCount)));
+}
+
+TEST(P12, ParallelDecode) {
+    srand(123);
+    Vector<Tuple<int, int>> encoded = {pair(0, 1)};
+    for (int i = 0; i < 10000; i++) {
+        encoded.push_back(pair(rand() % (i % 100 == 0 ? 10000 : 20), i));
+    }
+    for (unsigned threadCount : {0, 1, 2, 3, 7, 16}) {
+        EXPECT_EQ(decode(encoded), decodeParallel(encoded, threadCount));
+        EXPECT_TRUE(decodeParallel((Vector<Tuple<int, int>>) {}, threadCount).empty());
+    }
 }
 
 TEST(P13, RunLengthEncodingOfAList) {
@@ -121,6 +224,96 @@ TEST(P13, RunLengthEncodingOfAList) {
     expected = {pair(2, 'a'), pair(1, 'b')};
     actual = encodeDirect((List<char>) {'a', 'a', 'b'});
     EXPECT_EQ(expected, actual);
+
+    Vector<Tuple<int, char>> expectedVector = {pair(2, 'a'), pair(1, 'b')};
+    EXPECT_EQ(expectedVector, encodeDirect((Vector<char>) {'a', 'a', 'b'}));
+}
+
+TEST(P13, ParallelRunLengthEncoding) {
+    EXPECT_TRUE(encodeDirectParallel((Vector<int>) {}, 4).empty());
+
+    srand(123);
+    Vector<int> vector;
+    for (int i = 0; i < 10000; i++) {
+        vector.insert(vector.end(), rand() % 20 + 1, rand() % 3);
+    }
+    Vector<int> sameItems(1000, 42);
+    for (unsigned threadCount : {1, 2, 3, 7, 16, 64}) {
+        EXPECT_EQ(encodeDirect(vector), encodeDirectParallel(vector, threadCount));
+        EXPECT_EQ(encodeDirect(sameItems), encodeDirectParallel(sameItems, threadCount));
+        EXPECT_EQ(encodeDirect(slice(0, 5, vector)), encodeDirectParallel(slice(0, 5, vector), threadCount));
+    }
+}
+
+TEST(P13, StreamingRunLengthEncoding) {
+    std::istringstream input("aaabcc");
+    List<RunOf<char>> runs;
+    encodeStream(input, [&](RunLength count, char item) { runs.push_back(pair(count, item)); });
+    List<RunOf<char>> expected = {pair<RunLength>(3, 'a'), pair<RunLength>(1, 'b'), pair<RunLength>(2, 'c')};
+    EXPECT_EQ(expected, runs);
+
+    std::ostringstream output;
+    decodeStream(runs.begin(), runs.end(), std::ostreambuf_iterator<char>(output));
+    EXPECT_EQ("aaabcc", output.str());
+    EXPECT_EQ(8u, sizeof(RunLength));
+}
+
+TEST(P13, MemoryMappedEncodedFile) {
+    Vector<int> vector;
+    for (int i = 0; i < 5000; i++) {
+        vector.insert(vector.end(), i % 7 + 1, i % 3 == 0 ? -i : i);
+    }
+    std::string path = "p99-encoded-file.tmp";
+    writeEncodedFile(path, encodeDirect(vector), 16);
+    {
+        EncodedFile<int> file(path);
+        EXPECT_EQ(vector.size(), file.size());
+        EXPECT_EQ(5000u, file.runCount());
+        for (size_t i = 0; i < vector.size(); i += 13) {
+            EXPECT_EQ(vector[i], file.at(i));
+        }
+        EXPECT_EQ(Vector<int>(vector.begin() + 1234, vector.begin() + 9876), file.slice(1234, 9876));
+        EXPECT_EQ(vector, file.slice(0, file.size()));
+        EXPECT_TRUE(file.slice(7, 7).empty());
+        EXPECT_THROW(file.at(file.size()), std::out_of_range);
+        EXPECT_THROW(EncodedFile<char>{path}, std::runtime_error);
+    }
+    EXPECT_THROW(writeEncodedFile(path, encodeDirect(vector), 0), std::invalid_argument);
+
+    writeEncodedFile(path, encodeDirect((Vector<int>) {1, 1, 2}));
+    {
+        std::fstream corrupted(path, std::ios::binary | std::ios::in | std::ios::out);
+        corrupted.seekp(sizeof(EncodedFileHeader));
+        corrupted.write("\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF", 8);
+    }
+    {
+        EncodedFile<int> file(path);
+        EXPECT_THROW(file.at(2), std::runtime_error);
+    }
+
+    auto expectCorruptedHeaderRejected = [&](auto corrupt) {
+        writeEncodedFile(path, encodeDirect((Vector<int>) {1, 1, 2}));
+        {
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            EncodedFileHeader header;
+            file.read((char *) &header, sizeof(header));
+            EncodedFileIndexEntry firstEntry;
+            file.seekg(header.indexOffset);
+            file.read((char *) &firstEntry, sizeof(firstEntry));
+            corrupt(header, firstEntry);
+            file.seekp(0);
+            file.write((const char *) &header, sizeof(header));
+            file.seekp(header.indexOffset);
+            file.write((const char *) &firstEntry, sizeof(firstEntry));
+        }
+        EXPECT_THROW(EncodedFile<int>{path}, std::runtime_error);
+    };
+    expectCorruptedHeaderRejected([](EncodedFileHeader &header, EncodedFileIndexEntry &) { header.indexSize = (1ull << 60) + 1; });
+    expectCorruptedHeaderRejected([](EncodedFileHeader &header, EncodedFileIndexEntry &) { header.indexOffset -= 4; });
+    expectCorruptedHeaderRejected([](EncodedFileHeader &, EncodedFileIndexEntry &entry) { entry.itemOffset = 1; });
+    std::remove(path.c_str());
+
+    EXPECT_THROW(EncodedFile<int>{"p99-missing-file.tmp"}, std::runtime_error);
 }
 
 TEST(P14, DuplicateElementsOfAList) {
@@ -139,12 +332,34 @@ TEST(P15, DuplicateNElementsOfAList) {
     List<char> expected = {'a', 'a', 'a', 'b', 'b', 'b', 'c', 'c', 'c', 'c', 'c', 'c'};
     List<char> actual = duplicateN(3, (List<char>) { 'a', 'b', 'c', 'c' });
     EXPECT_EQ(expected, actual);
+
+    Vector<char> expectedVector = {'a', 'a', 'a', 'b', 'b', 'b'};
+    EXPECT_EQ(expectedVector, duplicateN(3, (Vector<char>) { 'a', 'b' }));
+    EXPECT_EQ((Vector<char>) {}, duplicateN(0, (Vector<char>) { 'a', 'b' }));
+}
+
+TEST(P15, ParallelDuplicateN) {
+    Vector<int> vector(1001);
+    std::iota(vector.begin(), vector.end(), 0);
+    for (unsigned threadCount : {0, 1, 2, 3, 7, 16}) {
+        EXPECT_EQ(duplicateN(7, vector), duplicateNParallel(7, vector, threadCount));
+        EXPECT_EQ(duplicate(vector), duplicateParallel(vector, threadCount));
+        EXPECT_TRUE(duplicateNParallel(0, vector, threadCount).empty());
+    }
 }
 
 TEST(P16, DropEveryNthElementFromList) {
     List<int> expected = {1, 2, 4, 5, 7, 8, 10};
     List<int> actual = dropEvery(3, (List<int>) {1, 2, 3, 4, 5, 6, 7, 8, 9, 10});
     EXPECT_EQ(expected, actual);
+
+    Vector<int> expectedVector = {1, 2, 4, 5, 7, 8, 10};
+    EXPECT_EQ(expectedVector, dropEvery(3, (Vector<int>) {1, 2, 3, 4, 5, 6, 7, 8, 9, 10}));
+
+    for (int index : {0, -2}) {
+        EXPECT_THROW(dropEvery(index, (List<int>) {1, 2, 3}), std::invalid_argument);
+        EXPECT_THROW(dropEvery(index, (Vector<int>) {1, 2, 3}), std::invalid_argument);
+    }
 }
 
 TEST(P17, SplitList) {
@@ -153,12 +368,22 @@ TEST(P17, SplitList) {
     Tuple<List<int>, List<int>> expected = pair(part1, part2);
     Tuple<List<int>, List<int>> actual = split(3, (List<int>) { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 });
     EXPECT_EQ(expected, actual);
+
+    Vector<int> vector = {1, 2, 3, 4};
+    Tuple<Vector<int>, Vector<int>> expectedVectors = pair((Vector<int>) {1, 2}, (Vector<int>) {3, 4});
+    EXPECT_EQ(expectedVectors, split(2, vector));
+    expectedVectors = pair(vector, (Vector<int>) {});
+    EXPECT_EQ(expectedVectors, split(5, vector));
 }
 
 TEST(P18, ExtractSliceFromAList) {
     List<int> expected = { 4, 5, 6, 7 };
     List<int> actual = slice(3, 7, (List<int>) { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 });
     EXPECT_EQ(expected, actual);
+
+    Vector<int> expectedVector = { 4, 5, 6, 7 };
+    EXPECT_EQ(expectedVector, slice(3, 7, (Vector<int>) { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 }));
+    EXPECT_EQ((Vector<int>) {}, slice(7, 3, (Vector<int>) { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 }));
 }
 
 TEST(P19, RotateListNPlaces) {
@@ -169,18 +394,111 @@ TEST(P19, RotateListNPlaces) {
     expected = {9, 10, 1, 2, 3, 4, 5, 6, 7, 8};
     actual = rotate(-2, (List<int>) {1, 2, 3, 4, 5, 6, 7, 8, 9, 10});
     EXPECT_EQ(expected, actual);
+
+    Vector<int> expectedVector = {4, 5, 1, 2, 3};
+    EXPECT_EQ(expectedVector, rotate(3, (Vector<int>) {1, 2, 3, 4, 5}));
+    EXPECT_EQ(expectedVector, rotate(-2, (Vector<int>) {1, 2, 3, 4, 5}));
+}
+
+TEST(P19, LazyViews) {
+    List<int> list = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    for (int from = -1; from <= 11; from++) {
+        for (int to = -1; to <= 11; to++) {
+            EXPECT_EQ(slice(from, to, list), collect<List<int>>(sliceView(from, to, list)));
+        }
+        EXPECT_EQ(rotate(from, list), collect<List<int>>(rotateView(from, list)));
+        EXPECT_EQ(rotate(-from, list), collect<List<int>>(rotateView(-from, list)));
+        EXPECT_EQ(std::get<0>(split(from, list)), collect<List<int>>(std::get<0>(splitView(from, list))));
+        EXPECT_EQ(std::get<1>(split(from, list)), collect<List<int>>(std::get<1>(splitView(from, list))));
+    }
+    for (int n = 1; n <= 11; n++) {
+        EXPECT_EQ(dropEvery(n, list), collect<List<int>>(dropEveryView(n, list)));
+        EXPECT_EQ(duplicateN(n - 1, list), collect<List<int>>(duplicateNView(n - 1, list)));
+    }
+    EXPECT_THROW(dropEveryView(0, list), std::invalid_argument);
+    EXPECT_THROW(dropEveryView(-2, list), std::invalid_argument);
+
+    auto huge = rangeView(1, 3000000000ll);
+    EXPECT_EQ(3000000000u, rotateView(-1, huge).size());
+    EXPECT_EQ(3000000000ll, *rotateView(-1, huge).begin());
+    EXPECT_EQ(2000000000u, dropEveryView(3, huge).size());
+    EXPECT_EQ(9000000000u, duplicateNView(3, huge).size());
+    EXPECT_EQ(5u, sliceView(0, 5, rotateView(-1, huge)).size());
+
+    Vector<int> vector(list.begin(), list.end());
+    auto view = sliceView(2, 7, rotateView(-3, dropEveryView(3, duplicateNView(2, vector))));
+    EXPECT_EQ(slice(2, 7, rotate(-3, dropEvery(3, duplicateN(2, vector)))), collect<Vector<int>>(view));
+    EXPECT_EQ(5u, view.size());
+
+    List<int> expected = {4, 5, 1, 2};
+    EXPECT_EQ(expected, collect<List<int>>(rotateView(-2, sliceView(0, 4, dropEveryView(3, list)))));
 }
 
 TEST(P20, RemoveNthElementFromList) {
     Tuple<List<int>, int> expected = pair((List<int>) {1, 2, 3, 5, 6, 7, 8, 9, 10}, 4);
     Tuple<List<int>, int> actual = removeAt(3, (List<int>) {1, 2, 3, 4, 5, 6, 7, 8, 9, 10});
     EXPECT_EQ(expected, actual);
+
+    Tuple<Vector<int>, int> expectedVector = pair((Vector<int>) {1, 3}, 2);
+    EXPECT_EQ(expectedVector, removeAt(1, (Vector<int>) {1, 2, 3}));
+    EXPECT_THROW(removeAt(3, (Vector<int>) {1, 2, 3}), std::invalid_argument);
 }
 
 TEST(P21, InsertElementIntoList) {
     List<int> expected = {1, 2, 3, 123, 4, 5, 6, 7, 8, 9, 10};
     List<int> actual = insertAt(3, 123, (List<int>) {1, 2, 3, 4, 5, 6, 7, 8, 9, 10});
     EXPECT_EQ(expected, actual);
+
+    Vector<int> expectedVector = {1, 2, 3, 123};
+    EXPECT_EQ(expectedVector, insertAt(3, 123, (Vector<int>) {1, 2, 3}));
+}
+
+TEST(P21, RvalueOverloadsReuseListNodes) {
+    List<int> list = {1, 2, 3, 4, 5};
+    const int *first = &list.front();
+    const int *last = &list.back();
+
+    list = reverse(std::move(list));
+    List<int> expected = {5, 4, 3, 2, 1};
+    EXPECT_EQ(expected, list);
+    EXPECT_EQ(first, &list.back());
+
+    list = rotate(2, std::move(list));
+    expected = {3, 2, 1, 5, 4};
+    EXPECT_EQ(expected, list);
+    EXPECT_EQ(last, &*std::next(list.begin(), 3));
+
+    list = std::get<0>(removeAt(3, std::move(list)));
+    expected = {3, 2, 1, 4};
+    EXPECT_EQ(expected, list);
+    EXPECT_EQ(first, &*std::next(list.begin(), 2));
+
+    list = insertAt(4, 9, std::move(list));
+    expected = {3, 2, 1, 4, 9};
+    EXPECT_EQ(expected, list);
+
+    auto parts = split(2, std::move(list));
+    expected = {3, 2};
+    EXPECT_EQ(expected, std::get<0>(parts));
+    expected = {1, 4, 9};
+    EXPECT_EQ(expected, std::get<1>(parts));
+    EXPECT_EQ(first, &std::get<1>(parts).front());
+
+    list = tailOf(std::move(std::get<1>(parts)));
+    expected = {4, 9};
+    EXPECT_EQ(expected, list);
+    EXPECT_THROW(tailOf(List<int>()), std::invalid_argument);
+}
+
+TEST(P21, InPlaceListOperations) {
+    List<int> list = {1, 2, 3, 4, 5};
+    reverseInPlace(list);
+    rotateInPlace(-1, list);
+    EXPECT_EQ(3, removeAtInPlace(3, list));
+    insertAtInPlace(0, 7, list);
+    List<int> expected = {7, 1, 5, 4, 2};
+    EXPECT_EQ(expected, list);
+    EXPECT_THROW(removeAtInPlace(5, list), std::invalid_argument);
 }
 
 TEST(P22, CreateListWithIntegersFromRange) {
@@ -189,9 +507,90 @@ TEST(P22, CreateListWithIntegersFromRange) {
     EXPECT_EQ(expected, actual);
 }
 
+TEST(P22, LazyRange) {
+    Vector<int64_t> expected = {4, 5, 6, 7, 8, 9};
+    EXPECT_EQ(expected, collect<Vector<int64_t>>(rangeView(4, 9)));
+    expected = {1, 4, 7, 10};
+    EXPECT_EQ(expected, collect<Vector<int64_t>>(rangeView(1, 11, 3)));
+    expected = {10, 6, 2};
+    EXPECT_EQ(expected, collect<Vector<int64_t>>(rangeView(10, 1, -4)));
+    EXPECT_TRUE(rangeView(5, 4).empty());
+    EXPECT_TRUE(rangeView(4, 5, -1).empty());
+    EXPECT_THROW(rangeView(1, 2, 0), std::invalid_argument);
+
+    auto billion = rangeView(1, 1000000000);
+    EXPECT_EQ(1000000000u, billion.size());
+    EXPECT_EQ(123456790, billion[123456789]);
+    EXPECT_EQ(1000000000, *(billion.end() - 1));
+    EXPECT_EQ(777, *std::lower_bound(billion.begin(), billion.end(), 777));
+    expected = {999999999, 1000000000};
+    EXPECT_EQ(expected, collect<Vector<int64_t>>(sliceView(999999998, 1000000000, billion)));
+
+    expected = {INT64_MIN, -1, INT64_MAX - 1};
+    EXPECT_EQ(expected, collect<Vector<int64_t>>(rangeView(INT64_MIN, INT64_MAX, INT64_MAX)));
+    expected = {INT64_MAX, INT64_MAX - 1};
+    EXPECT_EQ(expected, collect<Vector<int64_t>>(rangeView(INT64_MAX, INT64_MAX - 1, -1)));
+    EXPECT_THROW(rangeView(INT64_MIN, INT64_MAX), std::length_error);
+    EXPECT_THROW(rangeView(INT64_MAX, INT64_MIN, -1), std::length_error);
+    EXPECT_EQ(UINT64_MAX, rangeView(INT64_MIN + 1, INT64_MAX).size());
+
+    auto beyondInt = rangeView(1, 5000000000ll);
+    auto parts = splitView(4000000000ll, beyondInt);
+    EXPECT_EQ(4000000000u, std::get<0>(parts).size());
+    EXPECT_EQ(1000000000u, std::get<1>(parts).size());
+    expected = {4000000001ll, 4000000002ll, 4000000003ll};
+    EXPECT_EQ(expected, collect<Vector<int64_t>>(sliceView(0, 3, std::get<1>(parts))));
+    expected = {3000000001ll, 3000000003ll};
+    EXPECT_EQ(expected, collect<Vector<int64_t>>(dropEveryView(2, sliceView(3000000000ll, 3000000004ll, beyondInt))));
+    EXPECT_EQ(500000000u, dropEveryView(2, std::get<1>(parts)).size());
+    EXPECT_EQ(4000000002ll, *rotateView(1, std::get<1>(parts)).begin());
+}
+
+TEST(P22, ListsAllocatedFromMemoryResource) {
+    Vector<char> buffer(1 << 20);
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+    std::pmr::list<int> list = range(1, 5, &arena);
+    EXPECT_EQ(&arena, list.get_allocator().resource());
+
+    auto packed = pack(duplicate(list));
+    EXPECT_EQ(&arena, packed.get_allocator().resource());
+    EXPECT_EQ(&arena, packed.front().get_allocator().resource());
+    EXPECT_EQ(2, sizeOf(packed.front()));
+
+    auto encoded = encode(list);
+    EXPECT_EQ(&arena, encoded.get_allocator().resource());
+    EXPECT_EQ(&arena, decode(encoded).get_allocator().resource());
+    EXPECT_EQ(&arena, reverse(list).get_allocator().resource());
+    EXPECT_EQ(&arena, std::get<1>(split(2, list)).get_allocator().resource());
+
+    auto groups = group((List<int>) {2, 1}, list);
+    EXPECT_EQ(&arena, groups.get_allocator().resource());
+    EXPECT_EQ(&arena, groups.front().front().get_allocator().resource());
+    EXPECT_EQ(sizeOf(group((List<int>) {2, 1}, range(1, 5))), sizeOf(groups));
+
+    auto sorted = sortByLength(combinations(2, list));
+    EXPECT_EQ(&arena, sorted.get_allocator().resource());
+    EXPECT_EQ(&arena, sorted.back().get_allocator().resource());
+    Vector<int> expected = {1, 2, 3, 4, 5};
+    auto flattened = flatten(pack(list));
+    EXPECT_EQ(expected, Vector<int>(flattened.begin(), flattened.end()));
+
+    EXPECT_EQ(&arena, randomSelect(123u, 3, list).get_allocator().resource());
+    EXPECT_EQ(&arena, randomPermute(123u, list).get_allocator().resource());
+    EXPECT_EQ(&arena, collect<std::pmr::list<int>>(rotateView(2, list)).get_allocator().resource());
+    EXPECT_EQ(rotate(2, range(1, 5)), collect<List<int>>(rotateView(2, list)));
+
+    EXPECT_EQ(&arena, lotto(123, 3, 10, &arena).get_allocator().resource());
+    EXPECT_EQ(&arena, primeFactorsOf(315, &arena).get_allocator().resource());
+    auto factors = primeFactorsOf(315, &arena);
+    EXPECT_EQ(primeFactorsOf(315), List<int>(factors.begin(), factors.end()));
+    EXPECT_EQ(&arena, listPrimesInRange(10, 20, &arena).get_allocator().resource());
+    EXPECT_EQ(4, sizeOf(listPrimesInRange(10, 20, &arena)));
+}
+
 TEST(P23, ExtractGivenNumberOfRandomlySelectedElements) {
     unsigned int seed = 123;
-    List<int> expected = {2, 10, 9};
+    List<int> expected = {4, 7, 10};
     List<int> actual = randomSelect(seed, 3, (List<int>) {1, 2, 3, 4, 5, 6, 7, 8, 9, 10});
     EXPECT_EQ(expected, actual);
 
@@ -199,9 +598,35 @@ TEST(P23, ExtractGivenNumberOfRandomlySelectedElements) {
     EXPECT_EQ(5, sizeOf(list));
 }
 
+TEST(P23, SamplingWithPluggableRandomGenerator) {
+    std::mt19937 random(123);
+    Vector<int> vector = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    Vector<int> sample = randomSelect(random, 4, vector);
+    EXPECT_EQ(4, sizeOf(sample));
+    std::sort(sample.begin(), sample.end());
+    EXPECT_EQ(sample, compress(sample));
+    EXPECT_EQ(10, sizeOf(randomSelect(random, 20, vector)));
+
+    std::istringstream stream("1 2 3 4 5 6 7 8 9 10");
+    auto reservoir = reservoirSample(3, std::istream_iterator<int>(stream), std::istream_iterator<int>(), random);
+    EXPECT_EQ(3, sizeOf(reservoir));
+    std::sort(reservoir.begin(), reservoir.end());
+    EXPECT_EQ(reservoir, compress(reservoir));
+    EXPECT_EQ(2, sizeOf(reservoirSample(5, vector.begin(), vector.begin() + 2, random)));
+
+    Vector<int> frequency(10, 0);
+    for (int i = 0; i < 100000; i++) {
+        frequency[reservoirSample(1, vector.begin(), vector.end(), random)[0] - 1]++;
+        frequency[getElement(0, randomSelect(random, 1, vector)) - 1]++;
+    }
+    for (int count : frequency) {
+        EXPECT_NEAR(20000, count, 1000);
+    }
+}
+
 TEST(P24, Lotto_DrawNDifferentRandomNumbersFromRange1ToM) {
     unsigned int seed = 123;
-    List<int> expected = {1, 13, 20, 8, 45};
+    List<int> expected = {15, 10, 45, 26, 36};
     List<int> actual = lotto(seed, 5, 49);
     EXPECT_EQ(expected, actual);
 
@@ -209,9 +634,48 @@ TEST(P24, Lotto_DrawNDifferentRandomNumbersFromRange1ToM) {
     EXPECT_EQ(5, sizeOf(list));
 }
 
+TEST(P24, LottoFromHugeRange) {
+    Xoshiro256 random(123);
+    uint64_t endOfRange = 10000000000000000000ull;
+    auto numbers = lotto(random, 6, endOfRange);
+    EXPECT_EQ(6, sizeOf(numbers));
+    for (auto number : numbers) {
+        EXPECT_TRUE(number >= 1 && number <= endOfRange);
+    }
+    std::sort(numbers.begin(), numbers.end());
+    EXPECT_EQ(numbers, compress(numbers));
+
+    numbers = lotto(random, 10, 10);
+    std::sort(numbers.begin(), numbers.end());
+    Vector<uint64_t> expected = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    EXPECT_EQ(expected, numbers);
+    EXPECT_EQ(3, sizeOf(lotto(random, 5, 3)));
+    EXPECT_EQ(6, sizeOf(lotto(random, 6, UINT64_MAX)));
+}
+
+TEST(P24, BatchLottoDraws) {
+    Xoshiro256x4 lanes(123, 5);
+    Vector<Xoshiro256> generators = {Xoshiro256(123, 20), Xoshiro256(123, 21), Xoshiro256(123, 22), Xoshiro256(123, 23)};
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_EQ(generators[i % 4](), lanes());
+    }
+
+    auto draws = lottoBatch(123, 10000, 6, 49, 1);
+    EXPECT_EQ(60000, sizeOf(draws));
+    for (size_t draw = 0; draw < 10000; draw++) {
+        Vector<uint64_t> numbers(draws.begin() + draw * 6, draws.begin() + (draw + 1) * 6);
+        std::sort(numbers.begin(), numbers.end());
+        EXPECT_EQ(numbers, compress(numbers));
+        EXPECT_TRUE(numbers.front() >= 1 && numbers.back() <= 49);
+    }
+    EXPECT_EQ(draws, lottoBatch(123, 10000, 6, 49, 3));
+    EXPECT_NE(draws, lottoBatch(124, 10000, 6, 49, 3));
+    EXPECT_THROW(lottoBatch(123, 1, 6, 5), std::invalid_argument);
+}
+
 TEST(P25, GenerateRandomPermutationOfAList) {
     unsigned int seed = 123;
-    List<int> expected = {2, 5, 3, 1, 4};
+    List<int> expected = {2, 4, 5, 3, 1};
     List<int> actual = randomPermute(seed, (List<int>) {1, 2, 3, 4, 5});
     EXPECT_EQ(expected, actual);
 
@@ -219,6 +683,30 @@ TEST(P25, GenerateRandomPermutationOfAList) {
     EXPECT_EQ(100, sizeOf(list));
 }
 
+TEST(P25, ParallelRandomPermutationIsSameForAnyThreadCount) {
+    Vector<int> vector(300000);
+    std::iota(vector.begin(), vector.end(), 0);
+
+    auto permutation = randomPermuteParallel(123, vector, 1);
+    EXPECT_NE(vector, permutation);
+    for (unsigned threadCount : {2, 3, 8}) {
+        EXPECT_EQ(permutation, randomPermuteParallel(123, vector, threadCount));
+    }
+    EXPECT_NE(permutation, randomPermuteParallel(124, vector, 4));
+    std::sort(permutation.begin(), permutation.end());
+    EXPECT_EQ(vector, permutation);
+
+    Vector<int> small = {1, 2, 3};
+    Vector<int> frequency(3, 0);
+    for (uint64_t seed = 0; seed < 30000; seed++) {
+        frequency[randomPermuteParallel(seed, small, 2)[0] - 1]++;
+    }
+    for (int count : frequency) {
+        EXPECT_NEAR(10000, count, 500);
+    }
+    EXPECT_TRUE(randomPermuteParallel(123, (Vector<int>) {}).empty());
+}
+
 TEST(P26, Combinations) {
     List<List<int>> expected = {{1}, {2}, {3}};
     List<List<int>> actual = combinations(1, (List<int>) {1, 2, 3});
@@ -236,22 +724,160 @@ TEST(P26, Combinations) {
     EXPECT_EQ(220, sizeOf(actual));
 }
 
+TEST(P26, LazyCombinations) {
+    auto enumerator = lazyCombinations(3, (List<int>) {1, 2, 3, 4, 5});
+    EXPECT_EQ(10u, enumerator.count());
+    List<List<int>> actual;
+    while (enumerator.next()) {
+        EXPECT_EQ(actual.size(), enumerator.rank());
+        EXPECT_EQ(enumerator.rank(), rankOf(enumerator.mask()));
+        actual.push_back(List<int>(enumerator.current().begin(), enumerator.current().end()));
+    }
+    EXPECT_FALSE(enumerator.next());
+    List<List<int>> expected = combinations(3, (List<int>) {1, 2, 3, 4, 5});
+    expected.sort();
+    actual.sort();
+    EXPECT_EQ(expected, actual);
+
+    Vector<int> items(20);
+    std::iota(items.begin(), items.end(), 0);
+    CombinationEnumerator<int> fromRank(6, items, 12345);
+    CombinationEnumerator<int> fromStart(6, items);
+    for (int i = 0; i <= 12345; i++) fromStart.next();
+    for (int i = 0; i < 100; i++) {
+        EXPECT_TRUE(fromRank.next());
+        EXPECT_EQ(fromStart.current(), fromRank.current());
+        fromStart.next();
+    }
+
+    for (uint64_t rank = 0; rank < countCombinations(10, 4); rank++) {
+        EXPECT_EQ(rank, rankOf(unrank(10, 4, rank)));
+    }
+    EXPECT_EQ(0xFull, unrank(64, 4, 0));
+    EXPECT_EQ(0xFull << 60, unrank(64, 4, countCombinations(64, 4) - 1));
+    EXPECT_THROW(unrank(10, 4, 210), std::out_of_range);
+
+    EXPECT_EQ(220u, countCombinations(12, 3));
+    EXPECT_EQ(0u, countCombinations(3, 4));
+    EXPECT_EQ(1u, countCombinations(5, 0));
+    EXPECT_EQ(1832624140942590534ull, countCombinations(64, 32));
+    EXPECT_EQ(1u, lazyCombinations(0, items).count());
+    EXPECT_THROW(countCombinations(100, 50), std::overflow_error);
+    EXPECT_THROW(lazyCombinations(-1, items), std::invalid_argument);
+    EXPECT_THROW(lazyCombinations(50, Vector<int>(100)), std::invalid_argument);
+}
+
+TEST(P26, ParallelReductionOverCombinations) {
+    Vector<int> items(30);
+    std::iota(items.begin(), items.end(), 1);
+    auto sumOf = [&](uint64_t mask) {
+        int sum = 0;
+        for (; mask != 0; mask &= mask - 1) sum += items[__builtin_ctzll(mask)];
+        return sum;
+    };
+
+    uint64_t expectedEvenSums = 0;
+    for (CombinationEnumerator<int> it(5, items); it.next();) {
+        if (std::accumulate(it.current().begin(), it.current().end(), 0) % 2 == 0) expectedEvenSums++;
+    }
+    for (unsigned threadCount : {0, 1, 3, 8}) {
+        uint64_t evenSums = reduceCombinations(30, 5, (uint64_t) 0,
+                [&](uint64_t &count, uint64_t mask) { if (sumOf(mask) % 2 == 0) count++; },
+                [](uint64_t a, uint64_t b) { return a + b; }, threadCount);
+        EXPECT_EQ(expectedEvenSums, evenSums);
+
+        Vector<uint64_t> ranks = reduceCombinations(12, 4, Vector<uint64_t>(),
+                [](Vector<uint64_t> &result, uint64_t mask) { result.push_back(rankOf(mask)); },
+                [](Vector<uint64_t> a, const Vector<uint64_t> &b) { a.insert(a.end(), b.begin(), b.end()); return a; },
+                threadCount);
+        Vector<uint64_t> expectedRanks(countCombinations(12, 4));
+        std::iota(expectedRanks.begin(), expectedRanks.end(), 0);
+        EXPECT_EQ(expectedRanks, ranks);
+
+        auto hasSum = [&](int sum) {
+            return reduceCombinations(30, 5, false, [&](bool &found, uint64_t mask) { found = found || sumOf(mask) == sum; },
+                                      std::logical_or<bool>(), threadCount);
+        };
+        EXPECT_TRUE(hasSum(100));
+        EXPECT_FALSE(hasSum(141));
+    }
+
+    std::atomic<uint64_t> visited(0);
+    forEachCombinationParallel(20, 3, [&](uint64_t) { visited++; }, 4);
+    EXPECT_EQ(countCombinations(20, 3), visited);
+    EXPECT_EQ(0, reduceCombinations(3, 4, 0, [](int &count, uint64_t) { count++; }, std::plus<int>()));
+    EXPECT_THROW(reduceCombinations(65, 1, 0, [](int &count, uint64_t) { count++; }, std::plus<int>()), std::invalid_argument);
+}
+
 TEST(P27, GroupElementsIntoDisjoinedSubsets) {
     List<Combinations<int>> expected = {{{1}, {2, 3}}, {{2}, {1, 3}}, {{3}, {1, 2}}};
     List<Combinations<int>> actual = group((List<int>){1, 2}, (List<int>) range(1, 3));
     EXPECT_EQ(expected, actual);
 }
 
+TEST(P27, LazyGroupGenerator) {
+    List<int> items = range(1, 6);
+    List<Combinations<int>> expected = group((List<int>) {2, 1, 2}, items);
+    auto enumerator = lazyGroup((List<int>) {2, 1, 2}, items);
+    EXPECT_EQ(expected.size(), enumerator.count());
+    List<Combinations<int>> actual;
+    while (enumerator.next()) {
+        Combinations<int> grouping;
+        for (auto &items : enumerator.current()) {
+            grouping.push_back(List<int>(items.begin(), items.end()));
+        }
+        actual.push_back(grouping);
+    }
+    expected.sort();
+    actual.sort();
+    EXPECT_EQ(expected, actual);
+
+    Vector<int> groupSizes = {2, 3, 4};
+    Vector<int> people(9);
+    std::iota(people.begin(), people.end(), 0);
+    EXPECT_EQ(1260u, countGroupings(9, groupSizes));
+    for (uint64_t firstRank : {0, 1, 7, 300, 1259}) {
+        GroupEnumerator<int> fromRank(groupSizes, people, firstRank);
+        GroupEnumerator<int> fromStart(groupSizes, people);
+        for (uint64_t i = 0; i <= firstRank; i++) fromStart.next();
+        while (fromRank.next()) {
+            EXPECT_EQ(fromStart.masks(), fromRank.masks());
+            EXPECT_EQ(fromStart.rank(), fromRank.rank());
+            fromStart.next();
+        }
+        EXPECT_FALSE(fromStart.next());
+    }
+
+    EXPECT_EQ(1u, countGroupings(5, {}));
+    EXPECT_EQ(0u, countGroupings(3, {2, 2}));
+    EXPECT_EQ(3u, countGroupings(3, {2}));
+    EXPECT_THROW(countGroupings(64, {16, 16, 16, 16}), std::overflow_error);
+
+    // group() stops when items run out, lazyGroup() needs items for every group
+    auto truncated = group((List<int>) {2, 2, 1}, range(1, 4));
+    EXPECT_EQ(6, sizeOf(truncated));
+    EXPECT_EQ(2, sizeOf(truncated.front()));
+    EXPECT_EQ(0u, lazyGroup((List<int>) {2, 2, 1}, range(1, 4)).count());
+    EXPECT_EQ(0u, countGroupings(4, {2, 2, 1}));
+}
+
 TEST(P28a, SortListsByLengthOfSublists) {
-    List<List<int>> expected = {{0}, {1}, {2, 3}, {4, 5, 6}};
+    List<List<int>> expected = {{1}, {0}, {2, 3}, {4, 5, 6}};
     List<List<int>> actual = sortByLength((List<List<int>>) {{2,3}, {1}, {4,5,6}, {0}});
     EXPECT_EQ(expected, actual);
+
+    List<List<int>> empty;
+    EXPECT_EQ(empty, sortByLength(empty));
 }
 
 TEST(P28b, SortListsByLengthOfSublists) {
     List<List<int>> expected = {{2, 3}, {4, 5, 6}, {1}, {0}};
     List<List<int>> actual = sortByLengthFrequency((List<List<int>>) {{2,3}, {1}, {4,5,6}, {0}});
     EXPECT_EQ(expected, actual);
+
+    expected = {{}, {4, 5}, {7, 8}, {1}, {2}, {3}, {6}};
+    actual = sortByLengthFrequency((List<List<int>>) {{1}, {4,5}, {2}, {7,8}, {}, {3}, {6}});
+    EXPECT_EQ(expected, actual);
 }
 
 TEST(P31, DetermineIfIntegerIsPrime) {
@@ -261,6 +887,54 @@ TEST(P31, DetermineIfIntegerIsPrime) {
     EXPECT_EQ(true, isPrime(3));
     EXPECT_EQ(false, isPrime(4));
     EXPECT_EQ(true, isPrime(5));
+    EXPECT_EQ(false, isPrime(-7));
+    EXPECT_EQ(false, isPrime(46337 * 46327));
+    EXPECT_EQ(true, isPrime(2147483647));
+
+    Vector<bool> isSievedPrime(1100000, false);
+    forEachPrimeInRange(0, isSievedPrime.size() - 1, [&](uint64_t prime) { isSievedPrime[prime] = true; });
+    for (int n = 0; n < sizeOf(isSievedPrime); n++) {
+        EXPECT_EQ(isSievedPrime[n], isPrime(n)) << n;
+    }
+}
+
+TEST(P31, MillerRabinFor64BitNumbers) {
+    Vector<uint64_t> candidates;
+    Vector<bool> expected;
+    Vector<bool> isSievedPrime(1000000, false);
+    forEachPrimeInRange(0, 999999, [&](uint64_t prime) { isSievedPrime[prime] = true; });
+    for (uint64_t n = 0; n < 1000000; n++) {
+        EXPECT_EQ(isSievedPrime[n], isPrime64(n));
+        candidates.push_back(n);
+        expected.push_back(isSievedPrime[n]);
+    }
+
+    Vector<Tuple<uint64_t, bool>> knownNumbers = {
+            pair(561ull, false), // Carmichael number
+            pair(3215031751ull, false), // strong pseudoprime to bases 2, 3, 5 and 7
+            pair(3825123056546413051ull, false), // strong pseudoprime to bases up to 23
+            pair(4294967291ull * 4294967279ull, false),
+            pair(999999999989ull, true),
+            pair((1ull << 61) - 1, true),
+            pair(18446744073709551557ull, true), // largest 64-bit prime
+            pair(18446744073709551615ull, false)
+    };
+    for (auto &known : knownNumbers) {
+        EXPECT_EQ(std::get<1>(known), isPrime64(std::get<0>(known))) << std::get<0>(known);
+        candidates.push_back(std::get<0>(known));
+        expected.push_back(std::get<1>(known));
+    }
+    Xoshiro256 random(123);
+    for (int i = 0; i < 10000; i++) {
+        uint64_t n = random() | 1;
+        candidates.push_back(n);
+        expected.push_back(isPrime64(n));
+    }
+    EXPECT_EQ(expected, isPrime64(candidates));
+
+    EXPECT_TRUE(isPrime(7u));
+    EXPECT_TRUE(isPrime(7l));
+    EXPECT_TRUE(isPrime64((size_t) 7));
 }
 
 TEST(P32, DetermineGreatestCommonDivisor) {
@@ -292,6 +966,40 @@ TEST(P35, FindPrimeFactorOfNumber) {
     EXPECT_EQ(expected, primeFactorsOf(315));
 }
 
+TEST(P35, FactorizationOf64BitNumbers) {
+    Vector<uint64_t> expected;
+    expected = {};
+    EXPECT_EQ(expected, primeFactorsOf64(UINT64_C(1)));
+    expected = {71, 839, 1471, 6857};
+    EXPECT_EQ(expected, primeFactorsOf64(UINT64_C(600851475143)));
+    expected = {UINT64_C(4294967279), UINT64_C(4294967291)};
+    EXPECT_EQ(expected, primeFactorsOf64(UINT64_C(4294967291) * UINT64_C(4294967279)));
+    expected = {UINT64_C(4294967291), UINT64_C(4294967291)};
+    EXPECT_EQ(expected, primeFactorsOf64(UINT64_C(4294967291) * UINT64_C(4294967291)));
+    expected = {3, 5, 17, 257, 641, 65537, 6700417};
+    EXPECT_EQ(expected, primeFactorsOf64(UINT64_C(18446744073709551615)));
+    expected = {UINT64_C(18446744073709551557)};
+    EXPECT_EQ(expected, primeFactorsOf64(UINT64_C(18446744073709551557)));
+    expected = Vector<uint64_t>(63, 2);
+    EXPECT_EQ(expected, primeFactorsOf64(UINT64_C(1) << 63));
+    EXPECT_THROW(primeFactorsOf64(UINT64_C(0)), std::invalid_argument);
+    EXPECT_EQ(primeFactorsOf(315), primeFactorsOf(315l));
+    EXPECT_EQ(primeFactorMultiplicityOf(315), primeFactorMultiplicityOf(315u));
+    EXPECT_EQ(fastTotient(10), fastTotient(10ul));
+
+    Xoshiro256 random(123);
+    for (int i = 0; i < 1000; i++) {
+        uint64_t n = random() >> (random() % 64);
+        if (n == 0) continue;
+        uint64_t product = 1;
+        for (uint64_t factor : primeFactorsOf64(n)) {
+            EXPECT_TRUE(isPrime64(factor));
+            product *= factor;
+        }
+        EXPECT_EQ(n, product);
+    }
+}
+
 TEST(P36, FindPrimeFactorOfNumberAndTheirMultiplicity) {
     std::unordered_map<int, int> expected = {{3, 2}, {5, 1}, {7, 1}};
     EXPECT_EQ(expected, primeFactorMultiplicityOf(315));
@@ -301,11 +1009,124 @@ TEST(P37, CalculateTotientFunctionImproved) {
     EXPECT_EQ(4, fastTotient(10));
     EXPECT_EQ(40, fastTotient(100));
     EXPECT_EQ(400, fastTotient(1000));
+
+    for (int n = 1; n < 1000; n++) {
+        EXPECT_EQ((uint64_t) totient(n), fastTotient64((uint64_t) n));
+    }
+    EXPECT_EQ(UINT64_C(591194251200), fastTotient64(UINT64_C(600851475143)));
+    EXPECT_EQ(UINT64_C(18446744026464911390), fastTotient64(UINT64_C(4294967291) * UINT64_C(4294967291)));
+    std::unordered_map<uint64_t, int> expected = {{2, 1}, {3, 2}, {UINT64_C(4294967291), 1}};
+    EXPECT_EQ(expected, primeFactorMultiplicityOf64(18 * UINT64_C(4294967291)));
+}
+
+TEST(P37, TotientSieve) {
+    auto totients = totientsUpTo(1000000);
+    EXPECT_EQ(0u, totients[0]);
+    EXPECT_EQ(1u, totients[1]);
+    for (int n = 1; n < 2000; n++) {
+        EXPECT_EQ((uint32_t) totient(n), totients[n]);
+    }
+    SmallestPrimeFactorTable table(1000000);
+    for (uint32_t n = 1; n <= 1000000; n++) {
+        ASSERT_EQ(table.totient(n), totients[n]) << n;
+    }
+
+    for (unsigned threadCount : {1, 2, 5}) {
+        EXPECT_EQ(totients, totientsUpTo(1000000, threadCount));
+        for (uint32_t from : {0u, 1u, 2u, 999u, 65536u}) {
+            for (uint32_t to : {0u, 1u, 100u, 65537u, 1000000u}) {
+                Vector<uint32_t> expected;
+                if (from <= to) expected.assign(totients.begin() + from, totients.begin() + to + 1);
+                EXPECT_EQ(expected, totientsInRange(from, to, threadCount));
+            }
+        }
+    }
+
+    auto largeTotients = totientsInRange(UINT32_MAX - 1000, UINT32_MAX, 2);
+    for (uint32_t i = 0; i <= 1000; i++) {
+        EXPECT_EQ(fastTotient64((uint64_t) UINT32_MAX - 1000 + i), largeTotients[i]);
+    }
+}
+
+TEST(P37, SmallestPrimeFactorTable) {
+    SmallestPrimeFactorTable table(1000000);
+    SmallestPrimeFactorTable parallelTable(1000000, 3);
+    EXPECT_GE(table.memoryBytes(), 500000 * sizeof(uint32_t));
+    EXPECT_LT(table.memoryBytes(), 510000 * sizeof(uint32_t));
+
+    for (uint32_t n = 2; n <= 1000000; n++) {
+        ASSERT_EQ(table.smallestPrimeFactorOf(n), parallelTable.smallestPrimeFactorOf(n)) << n;
+    }
+    for (uint32_t n = 1; n < 2000; n++) {
+        EXPECT_EQ((uint32_t) totient((int) n), table.totient(n));
+    }
+    uint32_t factors[32];
+    for (uint32_t n : {2u, 97u, 1024u, 999983u, 1000000u, 720720u, 994009u}) {
+        auto expected = primeFactorsOf64((uint64_t) n);
+        size_t count = table.primeFactorsOf(n, factors);
+        EXPECT_EQ(expected, Vector<uint64_t>(factors, factors + count));
+        EXPECT_EQ(fastTotient64((uint64_t) n), table.totient(n));
+    }
+    EXPECT_EQ(0u, table.primeFactorsOf(1, factors));
+    EXPECT_THROW(table.smallestPrimeFactorOf(1000001), std::out_of_range);
+
+    for (uint32_t limit : {0u, 1u, 2u, 3u, 10u, 11u}) {
+        SmallestPrimeFactorTable small(limit, 1);
+        SmallestPrimeFactorTable smallParallel(limit, 4);
+        for (uint32_t n = 2; n <= limit; n++) {
+            EXPECT_EQ(primeFactorsOf64((uint64_t) n).front(), small.smallestPrimeFactorOf(n));
+            EXPECT_EQ(small.smallestPrimeFactorOf(n), smallParallel.smallestPrimeFactorOf(n));
+        }
+    }
 }
 
 TEST(P39, ListOfPrimeNumbers) {
     List<int> expected = {7, 11, 13, 17, 19, 23, 29, 31};
     EXPECT_EQ(expected, listPrimesInRange(7, 31));
+    expected = {2, 3, 5, 7};
+    EXPECT_EQ(expected, listPrimesInRange(-10, 10));
+}
+
+TEST(P39, SegmentedSieve) {
+    auto isPrimeByTrialDivision = [](uint64_t n) {
+        if (n < 2) return false;
+        for (uint64_t i = 2; i * i <= n; i++) {
+            if (n % i == 0) return false;
+        }
+        return true;
+    };
+    auto primesInRange = [](uint64_t from, uint64_t to, unsigned threadCount) {
+        Vector<uint64_t> result;
+        forEachPrimeInRange(from, to, [&](uint64_t prime) { result.push_back(prime); }, threadCount);
+        return result;
+    };
+
+    Vector<uint64_t> expected;
+    for (uint64_t n = 0; n <= 100000; n++) {
+        if (isPrimeByTrialDivision(n)) expected.push_back(n);
+    }
+    EXPECT_EQ(expected, primesInRange(0, 100000, 1));
+    for (uint64_t from : {0, 1, 2, 6, 7, 29, 30, 31, 49, 97}) {
+        for (uint64_t to : {0, 5, 7, 30, 31, 100, 1000}) {
+            Vector<uint64_t> expectedInRange;
+            for (uint64_t prime : expected) {
+                if (prime >= from && prime <= to) expectedInRange.push_back(prime);
+            }
+            EXPECT_EQ(expectedInRange, primesInRange(from, to, 2));
+        }
+    }
+
+    size_t count = 0;
+    forEachPrimeInRange(0, 10000000, [&](uint64_t) { count++; }, 4);
+    EXPECT_EQ(664579u, count);
+
+    uint64_t from = 1000000000000ull - 2000;
+    expected.clear();
+    for (uint64_t n = from; n <= 1000000000000ull; n++) {
+        if (isPrimeByTrialDivision(n)) expected.push_back(n);
+    }
+    EXPECT_EQ(expected, primesInRange(from, 1000000000000ull, 3));
+    EXPECT_EQ(999999999989ull, expected.back());
 }
 
 TEST(P40, GoldbachConjecture) {
@@ -1,74 +1,162 @@
 #include <list>
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <cmath>
 #include <iostream>
+#include <cstdint>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 #include <unordered_map>
+#include <unordered_set>
 #include <map>
 #include <CoreFoundation/CoreFoundation.h>
 #include "either/either.cpp"
 
+template<typename T, typename Allocator = std::allocator<T>>
+using List = std::list<T, Allocator>;
+
 template<typename T>
-using List = std::list<T>;
+using Vector = std::vector<T>;
 
 template<typename T>
 using Combinations = List<List<T>>;
 
+// Dereferences a const sequence so that Vector<bool> gives bool rather than a reference to its bit.
+template<typename Sequence>
+using ElementOf = typename std::decay<decltype(*std::begin(std::declval<const Sequence &>()))>::type;
+
+// Container of the same kind as Sequence but with elements of type U, e.g. Vector<int> -> Vector<Tuple<int, int>>.
+template<typename Sequence, typename U>
+struct Rebind;
+
+template<template<typename...> class Container, typename T, typename... Rest, typename U>
+struct Rebind<Container<T, Rest...>, U> {
+    using type = Container<U>;
+};
+
+// Keeps the kind of allocator, e.g. std::pmr::list<int> -> std::pmr::list<Tuple<int, int>>.
+template<template<typename...> class Container, typename T, typename Allocator, typename U>
+struct Rebind<Container<T, Allocator>, U> {
+    using type = Container<U, typename std::allocator_traits<Allocator>::template rebind_alloc<U>>;
+};
+
+template<typename Sequence, typename U>
+using RebindOf = typename Rebind<Sequence, U>::type;
+
+// Sequence of sequences using the same kind of allocator, e.g. List<T> -> List<List<T>>.
+template<typename Sequence>
+using NestedOf = RebindOf<Sequence, Sequence>;
+
+template<typename Sequence, typename = void>
+struct HasAllocator : std::false_type {};
+
+template<typename Sequence>
+struct HasAllocator<Sequence, decltype((void) std::declval<const Sequence &>().get_allocator())> : std::true_type {};
+
+template<typename Result, typename Sequence, typename = void>
+struct CanAllocateLike : std::false_type {};
+
+template<typename Result, typename Sequence>
+struct CanAllocateLike<Result, Sequence, typename std::enable_if<std::is_constructible<
+        typename Result::allocator_type, decltype(std::declval<const Sequence &>().get_allocator())>::value>::type> : std::true_type {};
+
+// Empty container which allocates from the same place as sequence, e.g. the same std::pmr::memory_resource.
+// Falls back to the default allocator when allocator of sequence can't be converted, e.g. from std::pmr to std.
+template<typename Result, typename Sequence>
+Result emptyLike(const Sequence &sequence) {
+    if constexpr (CanAllocateLike<Result, Sequence>::value) {
+        return Result(typename Result::allocator_type(sequence.get_allocator()));
+    } else {
+        return Result();
+    }
+}
+
+// Unlike copy constructor of pmr containers (which falls back to the default memory resource),
+// the copy allocates from the same place as sequence.
+template<typename Sequence>
+Sequence copyOf(const Sequence &sequence) {
+    if constexpr (HasAllocator<Sequence>::value) {
+        return Sequence(sequence, sequence.get_allocator());
+    } else {
+        return sequence;
+    }
+}
+
 template<typename T1, typename T2>
 using Tuple = std::tuple<T1, T2>;
 
 template<typename T1, typename T2>
 std::tuple<T1, T2> pair(T1 value1, T2 value2) {
-    return std::make_tuple(value1, value2);
+    return std::make_tuple(std::move(value1), std::move(value2));
 }
 
-template<typename T>
-int sizeOf(const List<T> &list);
-
+template<typename Sequence>
+int sizeOf(const Sequence &sequence) {
+    return (int) sequence.size();
+}
 
-template<typename T>
-T lastElementOf(const List<T> &list) {
-    return list.back();
+size_t clampIndex(int index, size_t size) {
+    if (index < 0) return 0;
+    return std::min((size_t) index, size);
 }
 
-template<typename T>
-T penultimate(const List<T> &list) {
-    if (sizeOf(list) < 2)
-        throw std::invalid_argument("List size should be >= 2 but was " + std::to_string(sizeOf(list)));
 
-    auto iterator = list.end();
-    iterator--;
-    iterator--;
-    return *iterator;
+template<typename Sequence>
+ElementOf<Sequence> lastElementOf(const Sequence &sequence) {
+    return sequence.back();
 }
 
-template<typename T>
-T getElement(int position, const List<T> &list) {
-    auto iterator = list.begin();
-    for (int i = 0; i < position; i++) {
-        iterator++;
-    }
-    return *iterator;
+template<typename Sequence>
+ElementOf<Sequence> penultimate(const Sequence &sequence) {
+    if (sizeOf(sequence) < 2)
+        throw std::invalid_argument("List size should be >= 2 but was " + std::to_string(sizeOf(sequence)));
+
+    return *std::prev(std::end(sequence), 2);
 }
 
-template<typename T>
-int sizeOf(const List<T> &list) {
-    int size = 0;
-    for (auto it = list.begin(); it != list.end(); it++) {
-        size++;
-    }
-    return size;
+// O(1) for random access sequences like Vector, O(position) for List.
+template<typename Sequence>
+ElementOf<Sequence> getElement(int position, const Sequence &sequence) {
+    return *std::next(std::begin(sequence), position);
 }
 
-template<typename T>
-List<T> reverse(const List<T> &list) {
-    List<T> result;
+template<typename T, typename Allocator>
+List<T, Allocator> reverse(const List<T, Allocator> &list) {
+    auto result = emptyLike<List<T, Allocator>>(list);
     for (auto item : list) {
         result.push_front(item);
     }
     return result;
 }
 
-template<typename T>
-bool isPalindrome(const List<T> &list) {
-    List<T> listCopy = list;
+template<typename T, typename Allocator>
+void reverseInPlace(List<T, Allocator> &list) {
+    list.reverse();
+}
+
+template<typename T, typename Allocator>
+List<T, Allocator> reverse(List<T, Allocator> &&list) {
+    reverseInPlace(list);
+    return std::move(list);
+}
+
+template<typename T, typename Allocator>
+bool isPalindrome(const List<T, Allocator> &list) {
+    auto listCopy = copyOf(list);
 
     while (listCopy.size() > 1) {
         T first = listCopy.front();
@@ -81,26 +169,161 @@ bool isPalindrome(const List<T> &list) {
     return true;
 }
 
-template<typename T>
-List<T> flatten(const List<List<T>> &listOfLists) {
-    List<T> result;
-    for (auto list : listOfLists) {
-        result.merge(list);
+template<typename T, typename Allocator, typename OuterAllocator>
+List<T, Allocator> flatten(const List<List<T, Allocator>, OuterAllocator> &listOfLists) {
+    auto result = emptyLike<List<T, Allocator>>(listOfLists);
+    for (auto &list : listOfLists) {
+        result.insert(result.end(), list.begin(), list.end());
+    }
+    return result;
+}
+
+// Splices nodes of inner lists in O(1) per list when they share allocator with the first one.
+template<typename T, typename Allocator, typename OuterAllocator>
+List<T, Allocator> flatten(List<List<T, Allocator>, OuterAllocator> &&listOfLists) {
+    if (listOfLists.empty()) return emptyLike<List<T, Allocator>>(listOfLists);
+
+    List<T, Allocator> result = std::move(listOfLists.front());
+    for (auto it = std::next(listOfLists.begin()); it != listOfLists.end(); it++) {
+        if (it->get_allocator() == result.get_allocator()) {
+            result.splice(result.end(), *it);
+        } else {
+            result.insert(result.end(), std::make_move_iterator(it->begin()), std::make_move_iterator(it->end()));
+        }
     }
     return result;
 }
 
+unsigned defaultThreadCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Splits [0, size) into threadCount contiguous chunks and calls f(chunk, from, to) for each chunk on its own thread.
+template<typename F>
+void parallelChunks(size_t size, unsigned threadCount, F f) {
+    threadCount = (unsigned) std::max<size_t>(1, std::min<size_t>(threadCount, size));
+    Vector<std::thread> threads;
+    for (unsigned chunk = 1; chunk < threadCount; chunk++) {
+        threads.emplace_back(f, chunk, size * chunk / threadCount, size * (chunk + 1) / threadCount);
+    }
+    f(0u, (size_t) 0, size / threadCount);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+template<typename T>
+size_t scalarRunBoundariesOf(const T *data, size_t from, size_t to, size_t *boundaries) {
+    size_t count = 0;
+    for (size_t i = from; i < to; i++) {
+        boundaries[count] = i;
+        count += data[i] != data[i - 1];
+    }
+    return count;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+size_t boundariesFromMask(unsigned mask, size_t offset, size_t *boundaries) {
+    size_t count = 0;
+    while (mask != 0) {
+        boundaries[count++] = offset + __builtin_ctz(mask);
+        mask &= mask - 1;
+    }
+    return count;
+}
+
+template<typename T>
+__attribute__((target("sse2")))
+size_t sse2RunBoundariesOf(const T *data, size_t from, size_t to, size_t *boundaries) {
+    const size_t width = 16 / sizeof(T);
+    size_t count = 0;
+    size_t i = from;
+    for (; i + width <= to; i += width) {
+        __m128i current = _mm_loadu_si128((const __m128i *) (data + i));
+        __m128i previous = _mm_loadu_si128((const __m128i *) (data + i - 1));
+        unsigned equal = sizeof(T) == 1 ?
+                _mm_movemask_epi8(_mm_cmpeq_epi8(current, previous)) :
+                _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(current, previous)));
+        count += boundariesFromMask(~equal & ((1u << width) - 1), i, boundaries + count);
+    }
+    return count + scalarRunBoundariesOf(data, i, to, boundaries + count);
+}
+
+template<typename T>
+__attribute__((target("avx2")))
+size_t avx2RunBoundariesOf(const T *data, size_t from, size_t to, size_t *boundaries) {
+    const size_t width = 32 / sizeof(T);
+    size_t count = 0;
+    size_t i = from;
+    for (; i + width <= to; i += width) {
+        __m256i current = _mm256_loadu_si256((const __m256i *) (data + i));
+        __m256i previous = _mm256_loadu_si256((const __m256i *) (data + i - 1));
+        unsigned equal = sizeof(T) == 1 ?
+                (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(current, previous)) :
+                (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(current, previous)));
+        unsigned allBits = width == 32 ? ~0u : (1u << width) - 1;
+        count += boundariesFromMask(~equal & allBits, i, boundaries + count);
+    }
+    return count + scalarRunBoundariesOf(data, i, to, boundaries + count);
+}
+
+#endif
+
 template<typename T>
-List<T> compress(const List<T> &list) {
-    if (sizeOf(list) < 2) return list;
+using RunBoundariesKernel = size_t (*)(const T *data, size_t from, size_t to, size_t *boundaries);
+
+template<typename T>
+RunBoundariesKernel<T> chooseRunBoundariesKernel() {
+#if defined(__x86_64__) || defined(__i386__)
+    if constexpr (std::is_integral<T>::value && (sizeof(T) == 1 || sizeof(T) == 4)) {
+        if (__builtin_cpu_supports("avx2")) return avx2RunBoundariesOf<T>;
+        if (__builtin_cpu_supports("sse2")) return sse2RunBoundariesOf<T>;
+    }
+#endif
+    return scalarRunBoundariesOf<T>;
+}
+
+// Calls onBoundary(i) in increasing order for each i in [1, size) where data[i] != data[i - 1].
+// Uses SSE2/AVX2 kernels for 8 and 32 bit integers when the CPU supports them.
+template<typename T, typename Callback>
+void forEachRunBoundary(const T *data, size_t size, Callback onBoundary) {
+    static const RunBoundariesKernel<T> kernel = chooseRunBoundariesKernel<T>();
+    const size_t blockSize = 1024;
+    size_t boundaries[blockSize];
+    for (size_t from = 1; from < size; from += blockSize) {
+        size_t count = kernel(data, from, std::min(from + blockSize, size), boundaries);
+        for (size_t i = 0; i < count; i++) {
+            onBoundary(boundaries[i]);
+        }
+    }
+}
+
+// Same as above for [from, to) of the vector, with boundary indices relative to the start of the vector.
+// Vector<bool> packs bits and has no data(), so it and non-arithmetic items are compared one by one.
+template<typename T, typename Callback>
+void forEachRunBoundary(const Vector<T> &vector, size_t from, size_t to, Callback onBoundary) {
+    if constexpr (std::is_arithmetic<T>::value && !std::is_same<T, bool>::value) {
+        forEachRunBoundary(vector.data() + from, to - from, [&](size_t boundary) {
+            onBoundary(from + boundary);
+        });
+    } else {
+        for (size_t i = from + 1; i < to; i++) {
+            if (vector[i] != vector[i - 1]) onBoundary(i);
+        }
+    }
+}
 
-    List<T> result;
+template<typename Sequence>
+Sequence compress(const Sequence &sequence) {
+    auto it = std::begin(sequence);
+    if (it == std::end(sequence)) return copyOf(sequence);
 
-    auto it = list.begin();
-    result.push_back(*it);
-    T lastItem = *it;
+    auto result = emptyLike<Sequence>(sequence);
+    auto lastItem = *it;
+    result.push_back(lastItem);
 
-    for (it++; it != list.end(); it++) {
+    for (it++; it != std::end(sequence); it++) {
         if (*it != lastItem) {
             result.push_back(*it);
             lastItem = *it;
@@ -110,35 +333,60 @@ List<T> compress(const List<T> &list) {
 }
 
 template<typename T>
-List<List<T>> pack(const List<T> &list) {
-    if (list.empty()) return {};
+Vector<T> compress(const Vector<T> &vector) {
+    if (vector.empty()) return vector;
+
+    Vector<T> result = {vector[0]};
+    forEachRunBoundary(vector, 0, vector.size(), [&](size_t boundary) {
+        result.push_back(vector[boundary]);
+    });
+    return result;
+}
+
+template<typename Sequence>
+RebindOf<Sequence, Sequence> pack(const Sequence &sequence) {
+    auto it = std::begin(sequence);
+    auto result = emptyLike<RebindOf<Sequence, Sequence>>(sequence);
+    if (it == std::end(sequence)) return result;
 
-    List<List<T>> result;
-    auto it = list.begin();
     auto lastItem = *it;
-    auto groupedItems = List<T>{lastItem};
+    auto groupedItems = emptyLike<Sequence>(sequence);
+    groupedItems.push_back(lastItem);
 
-    for (it++; it != list.end(); it++) {
+    for (it++; it != std::end(sequence); it++) {
         if (*it == lastItem) {
             groupedItems.push_back(*it);
         } else {
-            result.push_back(groupedItems);
+            result.push_back(std::move(groupedItems));
             lastItem = *it;
-            groupedItems = List<T>{lastItem};
+            groupedItems = emptyLike<Sequence>(sequence);
+            groupedItems.push_back(lastItem);
         }
     }
-    result.push_back(groupedItems);
+    result.push_back(std::move(groupedItems));
 
     return result;
 }
 
 template<typename T>
-List<Tuple<int, T>> encode(const List<T> &list) {
-    List<Tuple<int, T>> result;
+Vector<Vector<T>> pack(const Vector<T> &vector) {
+    Vector<Vector<T>> result;
+    size_t runStart = 0;
+    forEachRunBoundary(vector, 0, vector.size(), [&](size_t boundary) {
+        result.emplace_back(vector.begin() + runStart, vector.begin() + boundary);
+        runStart = boundary;
+    });
+    if (!vector.empty()) result.emplace_back(vector.begin() + runStart, vector.end());
+    return result;
+}
 
-    auto groupedItems = pack(list);
-    for (auto subList : groupedItems) {
-        auto tuple = pair(sizeOf(subList), lastElementOf(subList));
+template<typename Sequence>
+RebindOf<Sequence, Tuple<int, ElementOf<Sequence>>> encode(const Sequence &sequence) {
+    auto result = emptyLike<RebindOf<Sequence, Tuple<int, ElementOf<Sequence>>>>(sequence);
+
+    auto groupedItems = pack(sequence);
+    for (auto &subList : groupedItems) {
+        auto tuple = pair((int) subList.size(), subList.back());
         result.push_back(tuple);
     }
 
@@ -146,9 +394,22 @@ List<Tuple<int, T>> encode(const List<T> &list) {
 }
 
 template<typename T>
-List<Either<Tuple<int, T>, T>> encodeModified(const List<T> &list) {
-    List<Either<Tuple<int, T>, T>> result;
-    for (auto item : encode(list)) {
+Vector<Tuple<int, T>> encode(const Vector<T> &vector) {
+    Vector<Tuple<int, T>> result;
+    size_t runStart = 0;
+    forEachRunBoundary(vector, 0, vector.size(), [&](size_t boundary) {
+        result.push_back(pair((int) (boundary - runStart), vector[runStart]));
+        runStart = boundary;
+    });
+    if (!vector.empty()) result.push_back(pair((int) (vector.size() - runStart), vector[runStart]));
+    return result;
+}
+
+template<typename Sequence>
+RebindOf<Sequence, Either<Tuple<int, ElementOf<Sequence>>, ElementOf<Sequence>>> encodeModified(const Sequence &sequence) {
+    using T = ElementOf<Sequence>;
+    auto result = emptyLike<RebindOf<Sequence, Either<Tuple<int, T>, T>>>(sequence);
+    for (auto item : encode(sequence)) {
         if (std::get<0>(item) == 1) {
             result.push_back(Right<T>(std::get<1>(item)));
         } else {
@@ -158,9 +419,9 @@ List<Either<Tuple<int, T>, T>> encodeModified(const List<T> &list) {
     return result;
 }
 
-template<typename T>
-List<T> decode(const List<Tuple<int, T>> &encodedList) {
-    List<T> result;
+template<typename Encoded>
+RebindOf<Encoded, typename std::tuple_element<1, ElementOf<Encoded>>::type> decode(const Encoded &encodedList) {
+    auto result = emptyLike<RebindOf<Encoded, typename std::tuple_element<1, ElementOf<Encoded>>::type>>(encodedList);
     for (auto item : encodedList) {
         for (int i = 0; i < std::get<0>(item); i++) {
             result.push_back(std::get<1>(item));
@@ -170,276 +431,1891 @@ List<T> decode(const List<Tuple<int, T>> &encodedList) {
 }
 
 template<typename T>
-List<Tuple<int, T>> encodeDirect(const List<T> &list) {
-    auto it = list.begin();
-    if (it == list.end()) return {};
-
-    T lastItem = *it;
-    int count = 1;
-    List<Tuple<int, T>> result;
-    while (++it != list.end()) {
-        auto item = *it;
+Vector<T> decode(const Vector<Tuple<int, T>> &encodedVector) {
+    size_t size = 0;
+    for (auto &item : encodedVector) {
+        size += (size_t) std::max(0, std::get<0>(item));
+    }
+    Vector<T> result;
+    result.reserve(size);
+    for (auto &item : encodedVector) {
+        result.insert(result.end(), (size_t) std::max(0, std::get<0>(item)), std::get<1>(item));
+    }
+    return result;
+}
+
+using RunLength = uint64_t;
+
+template<typename T>
+using RunOf = Tuple<RunLength, T>;
+
+// Calls sink(count, item) for each run in [first, last) holding only the current run in memory.
+template<typename InputIterator, typename Sink>
+void encodeStream(InputIterator first, InputIterator last, Sink sink) {
+    if (first == last) return;
+
+    auto lastItem = *first;
+    RunLength count = 1;
+    while (++first != last) {
+        auto item = *first;
         if (item == lastItem) {
             count++;
         } else {
-            result.push_back(pair(count, lastItem));
+            sink(count, lastItem);
             count = 1;
+            lastItem = item;
         }
-        lastItem = item;
     }
-    result.push_back(pair(count, lastItem));
+    sink(count, lastItem);
+}
 
-    return result;
+template<typename Sink>
+void encodeStream(std::istream &input, Sink sink) {
+    encodeStream(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>(), sink);
 }
 
-template<typename T>
-List<T> duplicateN(int n, const List<T> &list) {
-    List<T> result;
-    for (auto item : list) {
-        for (int i = 0; i < n; i++) {
-            result.push_back(item);
-        }
+// Writes items of runs from [first, last) to output, e.g. std::ostreambuf_iterator.
+template<typename InputIterator, typename OutputIterator>
+OutputIterator decodeStream(InputIterator first, InputIterator last, OutputIterator output) {
+    for (; first != last; ++first) {
+        auto &&run = *first;
+        output = std::fill_n(output, std::get<0>(run), std::get<1>(run));
     }
+    return output;
+}
+
+template<typename Sequence>
+RebindOf<Sequence, Tuple<int, ElementOf<Sequence>>> encodeDirect(const Sequence &sequence) {
+    auto result = emptyLike<RebindOf<Sequence, Tuple<int, ElementOf<Sequence>>>>(sequence);
+    encodeStream(std::begin(sequence), std::end(sequence), [&](RunLength count, const ElementOf<Sequence> &item) {
+        result.push_back(pair((int) count, item));
+    });
     return result;
 }
 
 template<typename T>
-List<T> duplicate(const List<T> &list) {
-    return duplicateN(2, list);
+Vector<Tuple<int, T>> encodeDirect(const Vector<T> &vector) {
+    return encode(vector);
 }
 
+// Encodes chunks of the vector on separate threads and merges runs which continue across chunk boundaries.
 template<typename T>
-List<T> dropEvery(int index, const List<T> &list) {
-    List<T> result;
-    int i = 0;
-    for (auto item : list) {
-        if (++i % index == 0) continue;
-        result.push_back(item);
+Vector<Tuple<int, T>> encodeDirectParallel(const Vector<T> &vector, unsigned threadCount = defaultThreadCount()) {
+    threadCount = (unsigned) std::max<size_t>(1, std::min<size_t>(threadCount, vector.size()));
+    if (threadCount == 1) return encodeDirect(vector);
+
+    Vector<Vector<Tuple<int, T>>> chunkRuns(threadCount);
+    parallelChunks(vector.size(), threadCount, [&](unsigned chunk, size_t from, size_t to) {
+        auto &runs = chunkRuns[chunk];
+        size_t runStart = from;
+        forEachRunBoundary(vector, from, to, [&](size_t boundary) {
+            runs.push_back(pair((int) (boundary - runStart), vector[runStart]));
+            runStart = boundary;
+        });
+        if (from < to) runs.push_back(pair((int) (to - runStart), vector[runStart]));
+    });
+
+    Vector<size_t> skippedRuns(threadCount, 0);
+    Vector<size_t> offsets(threadCount + 1, 0);
+    Tuple<int, T> *lastRun = nullptr;
+    for (unsigned chunk = 0; chunk < threadCount; chunk++) {
+        auto &runs = chunkRuns[chunk];
+        if (lastRun != nullptr && !runs.empty() && std::get<1>(*lastRun) == std::get<1>(runs.front())) {
+            std::get<0>(*lastRun) += std::get<0>(runs.front());
+            skippedRuns[chunk] = 1;
+        }
+        if (runs.size() > skippedRuns[chunk]) lastRun = &runs.back();
+        offsets[chunk + 1] = offsets[chunk] + runs.size() - skippedRuns[chunk];
     }
+
+    Vector<Tuple<int, T>> result(offsets[threadCount]);
+    parallelChunks(threadCount, threadCount, [&](unsigned chunk, size_t, size_t) {
+        auto &runs = chunkRuns[chunk];
+        std::copy(runs.begin() + skippedRuns[chunk], runs.end(), result.begin() + offsets[chunk]);
+    });
     return result;
 }
 
-template<typename T>
-Tuple<List<T>, List<T>> split(int splitIndex, const List<T> &list) {
-    List<T> part1;
-    List<T> part2;
-    int i = 0;
-    for (auto item : list) {
-        if (++i <= splitIndex) {
-            part1.push_back(item);
-        } else {
-            part2.push_back(item);
+// Exclusive prefix sum computed in chunks on separate threads, result[i] = sum of values before i and result[size] = total.
+template<typename F>
+Vector<size_t> parallelPrefixSum(size_t size, unsigned threadCount, F valueAt) {
+    threadCount = std::max(1u, threadCount);
+    Vector<size_t> result(size + 1);
+    Vector<size_t> chunkSums(threadCount + 1, 0);
+    parallelChunks(size, threadCount, [&](unsigned chunk, size_t from, size_t to) {
+        size_t sum = 0;
+        for (size_t i = from; i < to; i++) {
+            sum += valueAt(i);
         }
-    }
-    return pair(part1, part2);
+        chunkSums[chunk + 1] = sum;
+    });
+    std::partial_sum(chunkSums.begin(), chunkSums.end(), chunkSums.begin());
+    parallelChunks(size, threadCount, [&](unsigned chunk, size_t from, size_t to) {
+        size_t sum = chunkSums[chunk];
+        for (size_t i = from; i < to; i++) {
+            result[i] = sum;
+            sum += valueAt(i);
+        }
+    });
+    result[size] = chunkSums.back();
+    return result;
 }
 
-template<typename T>
-List<T> slice(int from, int to, const List<T> &list) {
-    return std::get<1>(split(from, std::get<0>(split(to, list))));
+// Fills output with runs on separate threads, each thread writes an equal part of the output.
+// Run i covers [offsets[i], offsets[i + 1]) in the output.
+template<typename T, typename F>
+void fillRunsParallel(const Vector<size_t> &offsets, unsigned threadCount, F itemOfRun, T *output) {
+    parallelChunks(offsets.back(), threadCount, [&](unsigned, size_t from, size_t to) {
+        size_t run = std::upper_bound(offsets.begin(), offsets.end(), from) - offsets.begin() - 1;
+        for (size_t position = from; position < to; run++) {
+            size_t runEnd = std::min(offsets[run + 1], to);
+            std::fill(output + position, output + runEnd, itemOfRun(run));
+            position = runEnd;
+        }
+    });
 }
 
+// Sizes output with a parallel prefix sum of run lengths and then fills runs on separate threads.
 template<typename T>
-List<T> rotate(int shift, const List<T> &list) {
-    int index = shift >= 0 ? shift : sizeOf(list) + shift;
-    auto splitList = split(index, list);
-
-    List<T> part1 = std::get<0>(splitList);
-    List<T> part2 = std::get<1>(splitList);
-    part1.splice(part1.begin(), part2);
-
-    return part1;
+Vector<T> decodeParallel(const Vector<Tuple<int, T>> &encodedVector, unsigned threadCount = defaultThreadCount()) {
+    auto offsets = parallelPrefixSum(encodedVector.size(), threadCount, [&](size_t i) {
+        return (size_t) std::max(0, std::get<0>(encodedVector[i]));
+    });
+    Vector<T> result(offsets.back());
+    fillRunsParallel(offsets, threadCount, [&](size_t run) { return std::get<1>(encodedVector[run]); }, result.data());
+    return result;
 }
 
-template<typename T>
-Tuple<List<T>, T> removeAt(int index, const List<T> &list) {
-    if (index < 0 || index >= sizeOf(list))
-        throw std::invalid_argument(
-                "Cannot remove index: " + std::to_string(index) +
-                ", list size: " + std::to_string(sizeOf(list)));
-
-    List<T> newList;
-    T value;
-    int i = 0;
-    for (T item : list) {
-        if (i++ == index) {
-            value = item;
-        } else {
-            newList.push_back(item);
+// Concatenates random access sequence of sequences into one contiguous vector.
+// Offsets of inner sequences come from a parallel prefix sum of their sizes, then each thread copies an equal part of the output.
+template<typename Sequences>
+Vector<ElementOf<ElementOf<Sequences>>> flattenParallel(const Sequences &sequences, unsigned threadCount = defaultThreadCount()) {
+    auto offsets = parallelPrefixSum(sequences.size(), threadCount, [&](size_t i) {
+        return (size_t) sequences[i].size();
+    });
+    Vector<ElementOf<ElementOf<Sequences>>> result(offsets.back());
+    parallelChunks(result.size(), threadCount, [&](unsigned, size_t from, size_t to) {
+        size_t i = std::upper_bound(offsets.begin(), offsets.end(), from) - offsets.begin() - 1;
+        size_t skipped = from - offsets[i];
+        for (size_t position = from; position < to; i++, skipped = 0) {
+            size_t end = std::min(offsets[i + 1], to);
+            auto item = std::next(std::begin(sequences[i]), skipped);
+            for (; position < end; position++, item++) {
+                result[position] = *item;
+            }
         }
-    }
-    return pair(newList, value);
+    });
+    return result;
 }
 
-template<typename T>
-List<T> insertAt(int index, T element, const List<T> &list) {
-    List<T> result;
-    int i = 0;
-    for (auto item : list) {
-        if (i++ == index) {
-            result.push_back(element);
-        }
-        result.push_back(item);
-    }
-    if (index == sizeOf(result)) {
-        result.push_back(element);
+void writeVarint(uint64_t value, std::string &output) {
+    while (value >= 0x80) {
+        output.push_back((char) (value | 0x80));
+        value >>= 7;
     }
-    return result;
+    output.push_back((char) value);
 }
 
-List<int> range(int from, int to) {
-    List<int> result;
-    for (int i = from; i <= to; i++) {
-        result.push_back(i);
+// Throws if the varint doesn't end before end, e.g. in a truncated file.
+uint64_t readVarint(const uint8_t *&input, const uint8_t *end) {
+    uint64_t result = 0;
+    for (int shift = 0;; shift += 7) {
+        if (input == end || shift > 63) throw std::runtime_error("Corrupted varint");
+        uint8_t byte = *input++;
+        result |= (uint64_t) (byte & 0x7F) << shift;
+        if (byte < 0x80) return result;
     }
-    return result;
 }
 
 template<typename T>
-List<T> randomSelect(unsigned int seed, int amount, const List<T> &list) {
-    srand(seed);
-    List<T> listCopy = list;
-    List<T> result;
-    for (int i = 0; i < amount; i++) {
-        auto removed = removeAt(rand() % sizeOf(listCopy), listCopy);
-        listCopy = std::get<0>(removed);
-        T item = std::get<1>(removed);
-        result.push_back(item);
+uint64_t toVarintValue(T item) {
+    if (std::is_signed<T>::value) {
+        int64_t value = (int64_t) item;
+        return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63); // zigzag
     }
-    return result;
+    return (uint64_t) item;
 }
 
 template<typename T>
-List<T> randomSelect(int amount, const List<T> &list) {
-    return randomSelect((unsigned int) time(NULL), amount, list);
+T fromVarintValue(uint64_t value) {
+    if (std::is_signed<T>::value) {
+        return (T) (int64_t) ((value >> 1) ^ (~(value & 1) + 1));
+    }
+    return (T) value;
 }
 
-List<int> lotto(unsigned int seed, int amount, int endOfRange) {
-    return randomSelect(seed, amount, range(1, endOfRange));
-}
+// Layout in native (little endian) byte order:
+//   header
+//   runs section with (varint count, varint item) for each run, signed items are zigzag encoded
+//   index of (item offset, byte offset in runs section) for every indexStride-th run
+struct EncodedFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t itemSize;
+    uint32_t indexStride;
+    uint64_t runCount;
+    uint64_t itemCount;
+    uint64_t indexOffset;
+    uint64_t indexSize;
+};
 
-List<int> lotto(int amount, int endOfRange) {
-    return lotto((unsigned int) time(NULL), amount, endOfRange);
-}
+struct EncodedFileIndexEntry {
+    uint64_t itemOffset;
+    uint64_t byteOffset;
+};
 
-template<typename T>
-List<T> randomPermute(unsigned int seed, const List<T> &list) {
-    return randomSelect(seed, sizeOf(list), list);
-}
+const char encodedFileMagic[4] = {'P', '9', '9', 'R'};
+const uint32_t encodedFileVersion = 1;
+
+template<typename Encoded>
+void writeEncodedFile(const std::string &path, const Encoded &encoded, uint32_t indexStride = 64) {
+    using T = typename std::decay<typename std::tuple_element<1, ElementOf<Encoded>>::type>::type;
+    static_assert(std::is_integral<T>::value, "Only integral items can be written to encoded file");
+    if (indexStride == 0) throw std::invalid_argument("Index stride cannot be 0");
+
+    std::string runs;
+    Vector<EncodedFileIndexEntry> index;
+    uint64_t runCount = 0;
+    uint64_t itemCount = 0;
+    for (auto &run : encoded) {
+        if (std::get<0>(run) <= 0) continue;
+        if (runCount++ % indexStride == 0) {
+            index.push_back({itemCount, runs.size()});
+        }
+        writeVarint((uint64_t) std::get<0>(run), runs);
+        writeVarint(toVarintValue(std::get<1>(run)), runs);
+        itemCount += (uint64_t) std::get<0>(run);
+    }
 
-template<typename T>
-List<T> randomPermute(const List<T> &list) {
-    return randomPermute((unsigned int) time(NULL), list);
+    EncodedFileHeader header = {};
+    std::copy(encodedFileMagic, encodedFileMagic + 4, header.magic);
+    header.version = encodedFileVersion;
+    header.itemSize = sizeof(T);
+    header.indexStride = indexStride;
+    header.runCount = runCount;
+    header.itemCount = itemCount;
+    size_t padding = (8 - (sizeof(header) + runs.size()) % 8) % 8;
+    header.indexOffset = sizeof(header) + runs.size() + padding;
+    header.indexSize = index.size();
+
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+    output.write((const char *) &header, sizeof(header));
+    output.write(runs.data(), runs.size());
+    output.write("\0\0\0\0\0\0\0", padding);
+    output.write((const char *) index.data(), index.size() * sizeof(EncodedFileIndexEntry));
+    if (!output) throw std::runtime_error("Failed to write encoded file: " + path);
 }
 
+// Memory-mapped file written by writeEncodedFile. Items are decoded straight from the mapping,
+// finding an item takes O(log runs) for the index lookup plus at most indexStride runs.
 template<typename T>
-List<List<T>> combinations(int size, const List<T> &list) {
-    List<List<T>> result;
-    if (size <= 1) {
-        for (auto item : list) {
-            result.push_back({item});
+class EncodedFile {
+    static_assert(std::is_integral<T>::value, "Only integral items can be read from encoded file");
+public:
+    explicit EncodedFile(const std::string &path) {
+        int file = open(path.c_str(), O_RDONLY);
+        if (file < 0) throw std::runtime_error("Cannot open encoded file: " + path);
+        struct stat fileStat;
+        if (fstat(file, &fileStat) != 0 || fileStat.st_size < (off_t) sizeof(EncodedFileHeader)) {
+            close(file);
+            throw std::runtime_error("Not an encoded file: " + path);
         }
-        return result;
+        mappedSize = (size_t) fileStat.st_size;
+        void *mapping = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (mapping == MAP_FAILED) throw std::runtime_error("Cannot map encoded file: " + path);
+        data = (const uint8_t *) mapping;
+
+        header = (const EncodedFileHeader *) data;
+        if (!std::equal(encodedFileMagic, encodedFileMagic + 4, header->magic) ||
+            header->version != encodedFileVersion ||
+            header->itemSize != sizeof(T) ||
+            header->indexOffset < sizeof(EncodedFileHeader) ||
+            header->indexOffset > mappedSize ||
+            header->indexOffset % 8 != 0 ||
+            header->indexSize > (mappedSize - header->indexOffset) / sizeof(EncodedFileIndexEntry) ||
+            (header->indexSize == 0 && header->itemCount != 0) ||
+            (header->indexSize != 0 && ((const EncodedFileIndexEntry *) (data + header->indexOffset))->itemOffset != 0)) {
+            munmap((void *) data, mappedSize);
+            throw std::runtime_error("Not an encoded file: " + path);
+        }
+        runs = data + sizeof(EncodedFileHeader);
+        runsEnd = data + header->indexOffset;
+        index = (const EncodedFileIndexEntry *) (data + header->indexOffset);
     }
 
-    auto subList = list;
-    for (auto item : list) {
-        subList = slice(1, sizeOf(subList), subList);
-        auto subResult = combinations(size - 1, subList);
-        for (auto combination : subResult) {
-            result.push_back(insertAt(0, item, combination));
-        }
+    EncodedFile(const EncodedFile &) = delete;
+    EncodedFile &operator=(const EncodedFile &) = delete;
+
+    ~EncodedFile() {
+        munmap((void *) data, mappedSize);
     }
 
-    return result;
-}
+    uint64_t size() const { return header->itemCount; }
 
-template<typename T>
-List<T> tailOf(const List<T> &list) {
-    return std::get<0>(removeAt(0, list));
-}
+    uint64_t runCount() const { return header->runCount; }
 
-template<typename T>
-List<Combinations<T>> group(List<int> groupSizes, const List<T> &list) {
-    List<Combinations<T>> result;
-    if (groupSizes.empty() || list.empty()) {
-        result.push_back({});
+    T at(uint64_t position) const {
+        T result;
+        decodeSlice(position, position + 1, &result);
         return result;
     }
 
-    int groupSize = groupSizes.front();
-    auto itemCombinations = combinations(groupSize, list);
-    for (auto combination : itemCombinations) {
-        List<T> listCopy = list;
-        for (auto item : combination) {
-            listCopy.remove(item);
-        }
-        auto subResult = group(tailOf(groupSizes), listCopy);
-        for (auto subCombinations : subResult) {
-            result.push_back(insertAt(0, combination, subCombinations));
+    // Writes items in [from, to) to output.
+    template<typename OutputIterator>
+    OutputIterator decodeSlice(uint64_t from, uint64_t to, OutputIterator output) const {
+        if (from > to || to > size())
+            throw std::out_of_range(
+                    "Cannot decode slice [" + std::to_string(from) + ", " + std::to_string(to) +
+                    "), size: " + std::to_string(size()));
+        if (from == to) return output;
+
+        auto entry = std::upper_bound(index, index + header->indexSize, from, [](uint64_t offset, const EncodedFileIndexEntry &entry) {
+            return offset < entry.itemOffset;
+        }) - 1;
+        uint64_t runStart = entry->itemOffset;
+        if (entry->byteOffset > (uint64_t) (runsEnd - runs)) throw std::runtime_error("Corrupted encoded file index");
+        const uint8_t *input = runs + entry->byteOffset;
+        while (runStart < to) {
+            uint64_t count = readVarint(input, runsEnd);
+            T item = fromVarintValue<T>(readVarint(input, runsEnd));
+            uint64_t runEnd = runStart + count;
+            if (runEnd > from) {
+                output = std::fill_n(output, std::min(runEnd, to) - std::max(runStart, from), item);
+            }
+            runStart = runEnd;
         }
+        return output;
+    }
+
+    Vector<T> slice(uint64_t from, uint64_t to) const {
+        Vector<T> result;
+        result.reserve(to > from ? to - from : 0);
+        decodeSlice(from, to, std::back_inserter(result));
+        return result;
     }
 
+private:
+    const uint8_t *data;
+    size_t mappedSize;
+    const EncodedFileHeader *header;
+    const uint8_t *runs;
+    const uint8_t *runsEnd;
+    const EncodedFileIndexEntry *index;
+};
+
+template<typename Sequence>
+Sequence duplicateN(int n, const Sequence &sequence) {
+    auto result = emptyLike<Sequence>(sequence);
+    for (auto item : sequence) {
+        for (int i = 0; i < n; i++) {
+            result.push_back(item);
+        }
+    }
     return result;
 }
 
 template<typename T>
-List<List<T>> sortByLength(const List<List<T>> &list) {
-    List<List<T>> result = list;
-    result.sort();
+Vector<T> duplicateN(int n, const Vector<T> &vector) {
+    Vector<T> result;
+    if (n <= 0) return result;
+    result.reserve(vector.size() * n);
+    for (auto &item : vector) {
+        result.insert(result.end(), (size_t) n, item);
+    }
     return result;
 }
 
+template<typename Sequence>
+Sequence duplicate(const Sequence &sequence) {
+    return duplicateN(2, sequence);
+}
+
 template<typename T>
-List<List<T>> sortByLengthFrequency(const List<List<T>> &list) {
-    std::unordered_map<int, int> frequencyByLength;
-    for (auto item : list) {
-        int value;
-        std::unordered_map<int, int>::iterator it = frequencyByLength.find(sizeOf(item));
-        if (it == frequencyByLength.end()) {
-            value = 0;
-            std::pair <int,int> newItem = std::make_pair<int, int>(sizeOf(item), 0);
-            frequencyByLength.insert(newItem);
-        } else {
-            value = (*it).second;
+Vector<T> duplicateNParallel(int n, const Vector<T> &vector, unsigned threadCount = defaultThreadCount()) {
+    if (n <= 0) return {};
+    Vector<T> result(vector.size() * n);
+    parallelChunks(result.size(), threadCount, [&](unsigned, size_t from, size_t to) {
+        for (size_t position = from; position < to;) {
+            size_t i = position / n;
+            size_t runEnd = std::min((i + 1) * n, to);
+            std::fill(result.begin() + position, result.begin() + runEnd, vector[i]);
+            position = runEnd;
         }
-        frequencyByLength[sizeOf(item)] = value + 1;
-    }
-
-    List<List<T>> result = list;
-    result.sort([&](const List<T> &list1, const List<T> &list2) -> bool {
-        return frequencyByLength[sizeOf(list1)] < frequencyByLength[sizeOf(list2)];
     });
     return result;
 }
 
-bool isPrime(int n) {
-    if (n < 2) return false;
-    for (int i = (int) sqrt(n); i > 1; i--) {
-        if (n % i == 0) return false;
-    }
-    return true;
+template<typename T>
+Vector<T> duplicateParallel(const Vector<T> &vector, unsigned threadCount = defaultThreadCount()) {
+    return duplicateNParallel(2, vector, threadCount);
 }
 
-int gcd(int a, int b) {
-    if (b < a) {
-        int tmp = a;
-        a = b;
-        b = tmp;
-    }
-    while (b % a != 0) {
-        int reminder = b % a;
-        b = a;
-        a = reminder;
-    }
-    return a;
+void checkDropIndex(int index) {
+    if (index <= 0) throw std::invalid_argument("Index of dropped items should be > 0 but was " + std::to_string(index));
 }
 
-bool areCoprime(int a, int b) {
-    return gcd(a, b) == 1;
+template<typename Sequence>
+Sequence dropEvery(int index, const Sequence &sequence) {
+    checkDropIndex(index);
+    auto result = emptyLike<Sequence>(sequence);
+    int i = 0;
+    for (auto item : sequence) {
+        if (++i % index == 0) continue;
+        result.push_back(item);
+    }
+    return result;
 }
 
-int totient(int n) {
+template<typename T>
+Vector<T> dropEvery(int index, const Vector<T> &vector) {
+    checkDropIndex(index);
+    Vector<T> result;
+    result.reserve(vector.size() - vector.size() / index);
+    for (size_t from = 0; from < vector.size(); from += index) {
+        size_t to = std::min(from + index - 1, vector.size());
+        result.insert(result.end(), vector.begin() + from, vector.begin() + to);
+    }
+    return result;
+}
+
+template<typename Sequence>
+Tuple<Sequence, Sequence> split(int splitIndex, const Sequence &sequence) {
+    auto part1 = emptyLike<Sequence>(sequence);
+    auto part2 = emptyLike<Sequence>(sequence);
+    int i = 0;
+    for (auto item : sequence) {
+        if (++i <= splitIndex) {
+            part1.push_back(item);
+        } else {
+            part2.push_back(item);
+        }
+    }
+    return pair(std::move(part1), std::move(part2));
+}
+
+template<typename T>
+Tuple<Vector<T>, Vector<T>> split(int splitIndex, const Vector<T> &vector) {
+    auto middle = vector.begin() + clampIndex(splitIndex, vector.size());
+    return pair(Vector<T>(vector.begin(), middle), Vector<T>(middle, vector.end()));
+}
+
+template<typename T, typename Allocator>
+Tuple<List<T, Allocator>, List<T, Allocator>> split(int splitIndex, List<T, Allocator> &&list) {
+    auto part1 = emptyLike<List<T, Allocator>>(list);
+    part1.splice(part1.end(), list, list.begin(), std::next(list.begin(), clampIndex(splitIndex, list.size())));
+    return pair(std::move(part1), std::move(list));
+}
+
+template<typename Sequence>
+Sequence slice(int from, int to, const Sequence &sequence) {
+    return std::get<1>(split(from, std::get<0>(split(to, sequence))));
+}
+
+template<typename T>
+Vector<T> slice(int from, int to, const Vector<T> &vector) {
+    size_t end = clampIndex(to, vector.size());
+    size_t begin = std::min(clampIndex(from, vector.size()), end);
+    return Vector<T>(vector.begin() + begin, vector.begin() + end);
+}
+
+template<typename Sequence>
+Sequence rotate(int shift, const Sequence &sequence) {
+    int index = shift >= 0 ? shift : sizeOf(sequence) + shift;
+    auto splitList = split(index, sequence);
+
+    Sequence part1 = std::move(std::get<0>(splitList));
+    Sequence part2 = std::move(std::get<1>(splitList));
+    part2.insert(part2.end(), part1.begin(), part1.end());
+
+    return part2;
+}
+
+template<typename T>
+Vector<T> rotate(int shift, const Vector<T> &vector) {
+    int index = shift >= 0 ? shift : sizeOf(vector) + shift;
+    Vector<T> result;
+    result.reserve(vector.size());
+    std::rotate_copy(vector.begin(), vector.begin() + clampIndex(index, vector.size()), vector.end(), std::back_inserter(result));
+    return result;
+}
+
+template<typename T, typename Allocator>
+void rotateInPlace(int shift, List<T, Allocator> &list) {
+    int index = shift >= 0 ? shift : sizeOf(list) + shift;
+    list.splice(list.end(), list, list.begin(), std::next(list.begin(), clampIndex(index, list.size())));
+}
+
+template<typename T, typename Allocator>
+List<T, Allocator> rotate(int shift, List<T, Allocator> &&list) {
+    rotateInPlace(shift, list);
+    return std::move(list);
+}
+
+template<typename Sequence>
+Tuple<Sequence, ElementOf<Sequence>> removeAt(int index, const Sequence &sequence) {
+    if (index < 0 || index >= sizeOf(sequence))
+        throw std::invalid_argument(
+                "Cannot remove index: " + std::to_string(index) +
+                ", list size: " + std::to_string(sizeOf(sequence)));
+
+    auto newList = emptyLike<Sequence>(sequence);
+    ElementOf<Sequence> value;
+    int i = 0;
+    for (auto item : sequence) {
+        if (i++ == index) {
+            value = item;
+        } else {
+            newList.push_back(item);
+        }
+    }
+    return pair(std::move(newList), std::move(value));
+}
+
+template<typename T>
+Tuple<Vector<T>, T> removeAt(int index, const Vector<T> &vector) {
+    if (index < 0 || index >= sizeOf(vector))
+        throw std::invalid_argument(
+                "Cannot remove index: " + std::to_string(index) +
+                ", list size: " + std::to_string(sizeOf(vector)));
+
+    Vector<T> newVector;
+    newVector.reserve(vector.size() - 1);
+    newVector.insert(newVector.end(), vector.begin(), vector.begin() + index);
+    newVector.insert(newVector.end(), vector.begin() + index + 1, vector.end());
+    return pair(newVector, vector[index]);
+}
+
+template<typename T, typename Allocator>
+T removeAtInPlace(int index, List<T, Allocator> &list) {
+    if (index < 0 || index >= sizeOf(list))
+        throw std::invalid_argument(
+                "Cannot remove index: " + std::to_string(index) +
+                ", list size: " + std::to_string(sizeOf(list)));
+
+    auto it = std::next(list.begin(), index);
+    T value = std::move(*it);
+    list.erase(it);
+    return value;
+}
+
+template<typename T, typename Allocator>
+Tuple<List<T, Allocator>, T> removeAt(int index, List<T, Allocator> &&list) {
+    T value = removeAtInPlace(index, list);
+    return pair(std::move(list), std::move(value));
+}
+
+template<typename Sequence>
+Sequence insertAt(int index, ElementOf<Sequence> element, const Sequence &sequence) {
+    auto result = emptyLike<Sequence>(sequence);
+    int i = 0;
+    for (auto item : sequence) {
+        if (i++ == index) {
+            result.push_back(element);
+        }
+        result.push_back(item);
+    }
+    if (index == sizeOf(result)) {
+        result.push_back(element);
+    }
+    return result;
+}
+
+template<typename T>
+Vector<T> insertAt(int index, const typename Vector<T>::value_type &element, const Vector<T> &vector) {
+    if (index < 0 || index > sizeOf(vector)) return vector;
+
+    Vector<T> result;
+    result.reserve(vector.size() + 1);
+    result.insert(result.end(), vector.begin(), vector.begin() + index);
+    result.push_back(element);
+    result.insert(result.end(), vector.begin() + index, vector.end());
+    return result;
+}
+
+template<typename T, typename Allocator>
+void insertAtInPlace(int index, typename List<T, Allocator>::value_type element, List<T, Allocator> &list) {
+    if (index < 0 || index > sizeOf(list)) return;
+    list.insert(std::next(list.begin(), index), std::move(element));
+}
+
+template<typename T, typename Allocator>
+List<T, Allocator> insertAt(int index, typename List<T, Allocator>::value_type element, List<T, Allocator> &&list) {
+    insertAtInPlace(index, std::move(element), list);
+    return std::move(list);
+}
+
+// Lazy views produce items of the underlying range on iteration without copying it.
+// Views nested in other views are stored by value, other ranges by reference so they must outlive the view.
+// Views have get_allocator() of the underlying range if it has one, so collect() allocates from the same place.
+struct View {};
+
+template<typename Range>
+using StoredRange = typename std::conditional<std::is_base_of<View, Range>::value, Range, const Range &>::type;
+
+template<typename Range>
+struct ViewIterator {
+    using Underlying = decltype(std::begin(std::declval<const Range &>()));
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = ElementOf<Range>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type *;
+    using reference = decltype(*std::declval<Underlying>());
+};
+
+template<typename Range>
+class SliceView : public View {
+public:
+    SliceView(size_t from, size_t to, const Range &range): range(range), from(std::min(from, to)), to(to) {}
+
+    class Iterator : public ViewIterator<Range> {
+    public:
+        using Underlying = typename ViewIterator<Range>::Underlying;
+        Iterator(Underlying it, Underlying end, size_t position, size_t to): it(it), end(end), position(position), to(to) {}
+        typename ViewIterator<Range>::reference operator*() const { return *it; }
+        Iterator &operator++() { ++it; ++position; return *this; }
+        Iterator operator++(int) { Iterator result = *this; ++*this; return result; }
+        bool operator==(const Iterator &that) const { return atEnd() ? that.atEnd() : !that.atEnd() && position == that.position; }
+        bool operator!=(const Iterator &that) const { return !(*this == that); }
+    private:
+        bool atEnd() const { return position >= to || it == end; }
+        Underlying it, end;
+        size_t position, to;
+    };
+
+    Iterator begin() const {
+        auto it = std::begin(range);
+        size_t position = 0;
+        using Category = typename std::iterator_traits<decltype(it)>::iterator_category;
+        if constexpr (std::is_base_of<std::random_access_iterator_tag, Category>::value) {
+            position = std::min(from, (size_t) (std::end(range) - it));
+            it += position;
+        }
+        for (; position < from && it != std::end(range); position++) ++it;
+        return Iterator(it, std::end(range), position, to);
+    }
+    Iterator end() const { return Iterator(std::end(range), std::end(range), to, to); }
+    size_t size() const {
+        size_t rangeSize = std::size(range);
+        return std::min(to, rangeSize) - std::min(from, rangeSize);
+    }
+    template<typename R = Range>
+    auto get_allocator() const -> decltype(std::declval<const R &>().get_allocator()) { return range.get_allocator(); }
+
+private:
+    StoredRange<Range> range;
+    size_t from, to;
+};
+
+template<typename Range>
+class RotateView : public View {
+public:
+    RotateView(int shift, const Range &range): range(range) {
+        size_t rangeSize = std::size(range);
+        size_t shiftSize = (size_t) std::abs((int64_t) shift);
+        index = shift >= 0 ? std::min(shiftSize, rangeSize) : rangeSize - std::min(shiftSize, rangeSize);
+    }
+
+    class Iterator : public ViewIterator<Range> {
+    public:
+        using Underlying = typename ViewIterator<Range>::Underlying;
+        Iterator(Underlying it, Underlying begin, Underlying end, size_t position): it(it), begin(begin), end(end), position(position) {}
+        typename ViewIterator<Range>::reference operator*() const { return *it; }
+        Iterator &operator++() {
+            if (++it == end) it = begin;
+            ++position;
+            return *this;
+        }
+        Iterator operator++(int) { Iterator result = *this; ++*this; return result; }
+        bool operator==(const Iterator &that) const { return position == that.position; }
+        bool operator!=(const Iterator &that) const { return !(*this == that); }
+    private:
+        Underlying it, begin, end;
+        size_t position;
+    };
+
+    Iterator begin() const {
+        auto it = std::next(std::begin(range), index);
+        return Iterator(it == std::end(range) ? std::begin(range) : it, std::begin(range), std::end(range), 0);
+    }
+    Iterator end() const { return Iterator(std::begin(range), std::begin(range), std::end(range), size()); }
+    size_t size() const { return std::size(range); }
+    template<typename R = Range>
+    auto get_allocator() const -> decltype(std::declval<const R &>().get_allocator()) { return range.get_allocator(); }
+
+private:
+    StoredRange<Range> range;
+    size_t index;
+};
+
+template<typename Range>
+class DropEveryView : public View {
+public:
+    DropEveryView(int index, const Range &range): range(range), index(index) {
+        checkDropIndex(index);
+    }
+
+    class Iterator : public ViewIterator<Range> {
+    public:
+        using Underlying = typename ViewIterator<Range>::Underlying;
+        Iterator(Underlying it, Underlying end, size_t index): it(it), end(end), index(index), position(1) { skipDropped(); }
+        typename ViewIterator<Range>::reference operator*() const { return *it; }
+        Iterator &operator++() {
+            ++it;
+            ++position;
+            skipDropped();
+            return *this;
+        }
+        Iterator operator++(int) { Iterator result = *this; ++*this; return result; }
+        bool operator==(const Iterator &that) const { return it == that.it; }
+        bool operator!=(const Iterator &that) const { return !(*this == that); }
+    private:
+        void skipDropped() {
+            while (it != end && position % index == 0) {
+                ++it;
+                ++position;
+            }
+        }
+        Underlying it, end;
+        size_t index, position;
+    };
+
+    Iterator begin() const { return Iterator(std::begin(range), std::end(range), index); }
+    Iterator end() const { return Iterator(std::end(range), std::end(range), index); }
+    size_t size() const {
+        size_t rangeSize = std::size(range);
+        return rangeSize - rangeSize / index;
+    }
+    template<typename R = Range>
+    auto get_allocator() const -> decltype(std::declval<const R &>().get_allocator()) { return range.get_allocator(); }
+
+private:
+    StoredRange<Range> range;
+    size_t index;
+};
+
+template<typename Range>
+class DuplicateNView : public View {
+public:
+    DuplicateNView(int n, const Range &range): range(range), n(std::max(n, 0)) {}
+
+    class Iterator : public ViewIterator<Range> {
+    public:
+        using Underlying = typename ViewIterator<Range>::Underlying;
+        Iterator(Underlying it, int n): it(it), n(n), repetition(0) {}
+        typename ViewIterator<Range>::reference operator*() const { return *it; }
+        Iterator &operator++() {
+            if (++repetition == n) {
+                repetition = 0;
+                ++it;
+            }
+            return *this;
+        }
+        Iterator operator++(int) { Iterator result = *this; ++*this; return result; }
+        bool operator==(const Iterator &that) const { return it == that.it && repetition == that.repetition; }
+        bool operator!=(const Iterator &that) const { return !(*this == that); }
+    private:
+        Underlying it;
+        int n, repetition;
+    };
+
+    Iterator begin() const { return Iterator(n == 0 ? std::end(range) : std::begin(range), n); }
+    Iterator end() const { return Iterator(std::end(range), n); }
+    size_t size() const { return std::size(range) * (size_t) n; }
+    template<typename R = Range>
+    auto get_allocator() const -> decltype(std::declval<const R &>().get_allocator()) { return range.get_allocator(); }
+
+private:
+    StoredRange<Range> range;
+    int n;
+};
+
+// Bounds are 64-bit so that views over large ranges like rangeView() can be sliced anywhere.
+template<typename Range>
+SliceView<Range> sliceView(int64_t from, int64_t to, const Range &range) {
+    return SliceView<Range>((size_t) std::max<int64_t>(from, 0), (size_t) std::max<int64_t>(to, 0), range);
+}
+
+template<typename Range>
+Tuple<SliceView<Range>, SliceView<Range>> splitView(int64_t splitIndex, const Range &range) {
+    size_t index = (size_t) std::max<int64_t>(splitIndex, 0);
+    return pair(SliceView<Range>(0, index, range), SliceView<Range>(index, SIZE_MAX, range));
+}
+
+template<typename Range>
+RotateView<Range> rotateView(int shift, const Range &range) {
+    return RotateView<Range>(shift, range);
+}
+
+template<typename Range>
+DropEveryView<Range> dropEveryView(int index, const Range &range) {
+    return DropEveryView<Range>(index, range);
+}
+
+template<typename Range>
+DuplicateNView<Range> duplicateNView(int n, const Range &range) {
+    return DuplicateNView<Range>(n, range);
+}
+
+// Allocates from the same place as the range underlying views, e.g. the same std::pmr::memory_resource.
+template<typename Sequence, typename Range>
+Sequence collect(const Range &range) {
+    auto result = emptyLike<Sequence>(range);
+    result.insert(result.end(), std::begin(range), std::end(range));
+    return result;
+}
+
+// Lazy random access range of integers from, from + step, ... up to and including to, uses O(1) memory for any size.
+class RangeView : public View {
+public:
+    RangeView(int64_t from, int64_t to, int64_t step): from(from), step(step) {
+        if (step == 0) throw std::invalid_argument("Range step cannot be 0");
+        if (step > 0 && from <= to) {
+            count = ((uint64_t) to - (uint64_t) from) / (uint64_t) step + 1;
+        } else if (step < 0 && from >= to) {
+            count = ((uint64_t) from - (uint64_t) to) / (0 - (uint64_t) step) + 1;
+        } else {
+            return;
+        }
+        if (count == 0) throw std::length_error("Range from " + std::to_string(from) + " to " + std::to_string(to) + " has 2^64 items");
+    }
+
+    class Iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = int64_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int64_t *;
+        using reference = int64_t;
+
+        Iterator(int64_t from, int64_t step, uint64_t index): from(from), step(step), index(index) {}
+        int64_t operator*() const { return (int64_t) ((uint64_t) from + index * (uint64_t) step); }
+        int64_t operator[](difference_type n) const { return *(*this + n); }
+        Iterator &operator++() { ++index; return *this; }
+        Iterator operator++(int) { Iterator result = *this; ++*this; return result; }
+        Iterator &operator--() { --index; return *this; }
+        Iterator operator--(int) { Iterator result = *this; --*this; return result; }
+        Iterator &operator+=(difference_type n) { index += n; return *this; }
+        Iterator &operator-=(difference_type n) { index -= n; return *this; }
+        Iterator operator+(difference_type n) const { return Iterator(from, step, index + n); }
+        Iterator operator-(difference_type n) const { return Iterator(from, step, index - n); }
+        friend Iterator operator+(difference_type n, const Iterator &it) { return it + n; }
+        difference_type operator-(const Iterator &that) const { return (difference_type) (index - that.index); }
+        bool operator==(const Iterator &that) const { return index == that.index; }
+        bool operator!=(const Iterator &that) const { return index != that.index; }
+        bool operator<(const Iterator &that) const { return index < that.index; }
+        bool operator>(const Iterator &that) const { return index > that.index; }
+        bool operator<=(const Iterator &that) const { return index <= that.index; }
+        bool operator>=(const Iterator &that) const { return index >= that.index; }
+    private:
+        int64_t from, step;
+        uint64_t index;
+    };
+
+    Iterator begin() const { return Iterator(from, step, 0); }
+    Iterator end() const { return Iterator(from, step, count); }
+    int64_t operator[](uint64_t index) const { return begin()[index]; }
+    uint64_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+private:
+    int64_t from, step;
+    uint64_t count = 0;
+};
+
+RangeView rangeView(int64_t from, int64_t to, int64_t step = 1) {
+    return RangeView(from, to, step);
+}
+
+List<int> range(int from, int to) {
+    return collect<List<int>>(rangeView(from, to));
+}
+
+std::pmr::list<int> range(int from, int to, std::pmr::memory_resource *resource) {
+    auto numbers = rangeView(from, to);
+    return std::pmr::list<int>(numbers.begin(), numbers.end(), resource);
+}
+
+uint64_t splitMix64(uint64_t &state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// xoshiro256** generator, different streams of the same seed are seeded independently with splitmix64.
+class Xoshiro256 {
+public:
+    using result_type = uint64_t;
+
+    explicit Xoshiro256(uint64_t seed, uint64_t stream = 0) {
+        uint64_t state = seed ^ splitMix64(stream);
+        for (auto &word : s) {
+            word = splitMix64(state);
+        }
+    }
+
+    static constexpr uint64_t min() { return 0; }
+    static constexpr uint64_t max() { return UINT64_MAX; }
+
+    uint64_t operator()() {
+        uint64_t result = rotateLeft(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotateLeft(s[3], 45);
+        return result;
+    }
+
+private:
+    static uint64_t rotateLeft(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    uint64_t s[4];
+};
+
+// Four interleaved xoshiro256** generators refilling a buffer in bulk, the loop over lanes is vectorized by the compiler.
+// Lane i produces the same numbers as Xoshiro256(seed, stream * 4 + i), outputs of lanes alternate.
+class Xoshiro256x4 {
+public:
+    using result_type = uint64_t;
+    static const int lanes = 4;
+
+    Xoshiro256x4(uint64_t seed, uint64_t stream = 0): position(bufferSize) {
+        for (int lane = 0; lane < lanes; lane++) {
+            uint64_t laneStream = stream * lanes + lane;
+            uint64_t state = seed ^ splitMix64(laneStream);
+            for (auto &word : s) {
+                word[lane] = splitMix64(state);
+            }
+        }
+    }
+
+    static constexpr uint64_t min() { return 0; }
+    static constexpr uint64_t max() { return UINT64_MAX; }
+
+    uint64_t operator()() {
+        if (position == bufferSize) refill();
+        return buffer[position++];
+    }
+
+private:
+    void refill() {
+        for (size_t step = 0; step < bufferSize; step += lanes) {
+            for (int lane = 0; lane < lanes; lane++) {
+                uint64_t x = s[1][lane] * 5;
+                buffer[step + lane] = ((x << 7) | (x >> 57)) * 9;
+                uint64_t t = s[1][lane] << 17;
+                s[2][lane] ^= s[0][lane];
+                s[3][lane] ^= s[1][lane];
+                s[1][lane] ^= s[2][lane];
+                s[0][lane] ^= s[3][lane];
+                s[2][lane] ^= t;
+                s[3][lane] = (s[3][lane] << 45) | (s[3][lane] >> 19);
+            }
+        }
+        position = 0;
+    }
+
+    static const size_t bufferSize = 64;
+    uint64_t s[4][lanes];
+    uint64_t buffer[bufferSize];
+    size_t position;
+};
+
+template<typename Random>
+using IfRandomGenerator = typename std::enable_if<!std::is_arithmetic<Random>::value>::type;
+
+template<typename Random>
+uint64_t randomBits(Random &random) {
+    static_assert(Random::max() - Random::min() >= UINT32_MAX, "Random generator should produce at least 32 bits");
+    if (Random::max() - Random::min() == UINT64_MAX) return random() - Random::min();
+    uint64_t high = (uint64_t) (random() - Random::min()) << 32;
+    return high | (uint32_t) (random() - Random::min());
+}
+
+// Uniform number in [0, bound) using Lemire's multiply-and-reject.
+// Unlike std::uniform_int_distribution the result is the same with any standard library.
+template<typename Random>
+uint64_t randomBelow(uint64_t bound, Random &random) {
+    unsigned __int128 product = (unsigned __int128) randomBits(random) * bound;
+    if ((uint64_t) product < bound) {
+        uint64_t threshold = (0 - bound) % bound;
+        while ((uint64_t) product < threshold) {
+            product = (unsigned __int128) randomBits(random) * bound;
+        }
+    }
+    return (uint64_t) (product >> 64);
+}
+
+// Uniform number in (0, 1).
+template<typename Random>
+double randomUnitInterval(Random &random) {
+    return ((randomBits(random) >> 11) + 0.5) * 0x1.0p-53;
+}
+
+// Partial Fisher-Yates shuffle, moves a uniformly random sample of amount items in random order to the front.
+template<typename T, typename Random>
+void partialShuffle(size_t amount, Vector<T> &items, Random &random) {
+    amount = std::min(amount, items.size());
+    for (size_t i = 0; i < amount; i++) {
+        std::swap(items[i], items[i + randomBelow(items.size() - i, random)]);
+    }
+}
+
+// Reservoir sampling (Algorithm L) of amount items from a single pass over a stream of unknown length.
+template<typename InputIterator, typename Random>
+Vector<typename std::iterator_traits<InputIterator>::value_type>
+reservoirSample(size_t amount, InputIterator first, InputIterator last, Random &random) {
+    Vector<typename std::iterator_traits<InputIterator>::value_type> reservoir;
+    if (amount == 0) return reservoir;
+    for (; first != last && reservoir.size() < amount; ++first) {
+        reservoir.push_back(*first);
+    }
+
+    double w = std::exp(std::log(randomUnitInterval(random)) / amount);
+    while (first != last) {
+        auto skip = (uint64_t) std::floor(std::log(randomUnitInterval(random)) / std::log1p(-w));
+        for (; skip > 0 && first != last; skip--) ++first;
+        if (first == last) break;
+
+        reservoir[randomBelow(amount, random)] = *first;
+        ++first;
+        w *= std::exp(std::log(randomUnitInterval(random)) / amount);
+    }
+    return reservoir;
+}
+
+template<typename Sequence, typename Random, typename = IfRandomGenerator<Random>>
+Sequence randomSelect(Random &random, int amount, const Sequence &sequence) {
+    Vector<ElementOf<Sequence>> items(std::begin(sequence), std::end(sequence));
+    size_t sampleSize = clampIndex(amount, items.size());
+    partialShuffle(sampleSize, items, random);
+    auto result = emptyLike<Sequence>(sequence);
+    result.insert(result.end(), std::make_move_iterator(items.begin()), std::make_move_iterator(items.begin() + sampleSize));
+    return result;
+}
+
+template<typename Sequence>
+Sequence randomSelect(unsigned int seed, int amount, const Sequence &sequence) {
+    std::mt19937_64 random(seed);
+    return randomSelect(random, amount, sequence);
+}
+
+template<typename Sequence>
+Sequence randomSelect(int amount, const Sequence &sequence) {
+    return randomSelect((unsigned int) time(NULL), amount, sequence);
+}
+
+// Draws amount distinct numbers from [1, endOfRange] in random order using Floyd's algorithm,
+// takes O(amount) time and memory regardless of the range size.
+template<typename Random, typename = IfRandomGenerator<Random>>
+Vector<uint64_t> lotto(Random &random, uint64_t amount, uint64_t endOfRange) {
+    amount = std::min(amount, endOfRange);
+    std::unordered_set<uint64_t> drawn(amount * 2);
+    Vector<uint64_t> result;
+    result.reserve(amount);
+    for (uint64_t i = 0; i < amount; i++) {
+        uint64_t last = endOfRange - amount + 1 + i;
+        uint64_t number = 1 + randomBelow(last, random);
+        if (!drawn.insert(number).second) {
+            number = last;
+            drawn.insert(number);
+        }
+        result.push_back(number);
+    }
+    partialShuffle(result.size(), result, random); // order of numbers from Floyd's algorithm is not uniform
+    return result;
+}
+
+List<int> lotto(unsigned int seed, int amount, int endOfRange) {
+    std::mt19937_64 random(seed);
+    auto numbers = lotto(random, (uint64_t) std::max(amount, 0), (uint64_t) std::max(endOfRange, 0));
+    return List<int>(numbers.begin(), numbers.end());
+}
+
+std::pmr::list<int> lotto(unsigned int seed, int amount, int endOfRange, std::pmr::memory_resource *resource) {
+    std::mt19937_64 random(seed);
+    auto numbers = lotto(random, (uint64_t) std::max(amount, 0), (uint64_t) std::max(endOfRange, 0));
+    return std::pmr::list<int>(numbers.begin(), numbers.end(), resource);
+}
+
+// Fills a flat buffer with drawCount independent draws of amount distinct numbers from [1, endOfRange],
+// draw i takes items [i * amount, (i + 1) * amount). Numbers within a draw are not in random order.
+// Blocks of draws have their own generator stream so the result doesn't depend on the number of threads.
+Vector<uint64_t> lottoBatch(uint64_t seed, size_t drawCount, uint32_t amount, uint64_t endOfRange,
+                            unsigned threadCount = defaultThreadCount()) {
+    if (amount > endOfRange)
+        throw std::invalid_argument(
+                "Cannot draw " + std::to_string(amount) + " distinct numbers from range 1.." + std::to_string(endOfRange));
+
+    const size_t blockSize = 4096;
+    Vector<uint64_t> result(drawCount * amount);
+    size_t blockCount = (drawCount + blockSize - 1) / blockSize;
+    parallelChunks(blockCount, threadCount, [&](unsigned, size_t fromBlock, size_t toBlock) {
+        for (size_t block = fromBlock; block < toBlock; block++) {
+            Xoshiro256x4 random(seed, block);
+            for (size_t draw = block * blockSize; draw < std::min(drawCount, (block + 1) * blockSize); draw++) {
+                uint64_t *numbers = result.data() + draw * amount;
+                for (uint32_t i = 0; i < amount; i++) { // Floyd's algorithm
+                    uint64_t last = endOfRange - amount + 1 + i;
+                    uint64_t number = 1 + randomBelow(last, random);
+                    if (std::find(numbers, numbers + i, number) != numbers + i) number = last;
+                    numbers[i] = number;
+                }
+            }
+        }
+    });
+    return result;
+}
+
+List<int> lotto(int amount, int endOfRange) {
+    return lotto((unsigned int) time(NULL), amount, endOfRange);
+}
+
+template<typename Sequence, typename Random, typename = IfRandomGenerator<Random>>
+Sequence randomPermute(Random &random, const Sequence &sequence) {
+    return randomSelect(random, sizeOf(sequence), sequence);
+}
+
+template<typename Sequence>
+Sequence randomPermute(unsigned int seed, const Sequence &sequence) {
+    return randomSelect(seed, sizeOf(sequence), sequence);
+}
+
+template<typename Sequence>
+Sequence randomPermute(const Sequence &sequence) {
+    return randomPermute((unsigned int) time(NULL), sequence);
+}
+
+// Sends each item to a random bucket and shuffles buckets with Fisher-Yates, which gives a uniform permutation.
+// Blocks of items and buckets use their own generator streams and their sizes depend only on the vector size,
+// so for a seed the result is the same with any number of threads.
+template<typename T>
+Vector<T> randomPermuteParallel(uint64_t seed, const Vector<T> &vector, unsigned threadCount = defaultThreadCount()) {
+    const size_t blockSize = 1 << 16;
+    size_t blockCount = (vector.size() + blockSize - 1) / blockSize;
+    size_t bucketCount = std::max<size_t>(1, std::min<size_t>(vector.size() / blockSize, 1024));
+    auto forEachBucketOfBlock = [&](size_t block, auto f) {
+        Xoshiro256 random(seed, block);
+        for (size_t item = block * blockSize; item < std::min(vector.size(), (block + 1) * blockSize); item++) {
+            f(item, randomBelow(bucketCount, random));
+        }
+    };
+
+    Vector<size_t> offsets(blockCount * bucketCount, 0);
+    parallelChunks(blockCount, threadCount, [&](unsigned, size_t from, size_t to) {
+        for (size_t block = from; block < to; block++) {
+            forEachBucketOfBlock(block, [&](size_t, size_t bucket) { offsets[block * bucketCount + bucket]++; });
+        }
+    });
+    Vector<size_t> bucketOffsets(bucketCount + 1, 0);
+    for (size_t bucket = 0; bucket < bucketCount; bucket++) {
+        size_t offset = bucketOffsets[bucket];
+        for (size_t block = 0; block < blockCount; block++) {
+            size_t count = offsets[block * bucketCount + bucket];
+            offsets[block * bucketCount + bucket] = offset;
+            offset += count;
+        }
+        bucketOffsets[bucket + 1] = offset;
+    }
+
+    Vector<T> result(vector.size());
+    parallelChunks(blockCount, threadCount, [&](unsigned, size_t from, size_t to) {
+        for (size_t block = from; block < to; block++) {
+            forEachBucketOfBlock(block, [&](size_t item, size_t bucket) {
+                result[offsets[block * bucketCount + bucket]++] = vector[item];
+            });
+        }
+    });
+    parallelChunks(bucketCount, threadCount, [&](unsigned, size_t from, size_t to) {
+        for (size_t bucket = from; bucket < to; bucket++) {
+            Xoshiro256 random(seed, blockCount + bucket);
+            size_t begin = bucketOffsets[bucket];
+            for (size_t end = bucketOffsets[bucket + 1]; end > begin + 1; end--) {
+                std::swap(result[end - 1], result[begin + randomBelow(end - begin, random)]);
+            }
+        }
+    });
+    return result;
+}
+
+template<typename T, typename Allocator>
+NestedOf<List<T, Allocator>> combinations(int size, const List<T, Allocator> &list) {
+    auto result = emptyLike<NestedOf<List<T, Allocator>>>(list);
+    if (size <= 1) {
+        for (auto item : list) {
+            result.emplace_back(1, item);
+        }
+        return result;
+    }
+
+    auto subList = copyOf(list);
+    for (auto item : list) {
+        subList = slice(1, sizeOf(subList), subList);
+        auto subResult = combinations(size - 1, subList);
+        for (auto &combination : subResult) {
+            result.push_back(insertAt(0, item, combination));
+        }
+    }
+
+    return result;
+}
+
+// Number of size-combinations of n items, throws std::overflow_error if it doesn't fit into uint64_t.
+uint64_t countCombinations(uint64_t n, uint64_t size) {
+    if (size > n) return 0;
+    size = std::min(size, n - size);
+    uint64_t result = 1;
+    for (uint64_t i = 1; i <= size; i++) {
+        unsigned __int128 next = (unsigned __int128) result * (n - size + i) / i;
+        if (next > UINT64_MAX)
+            throw std::overflow_error(
+                    "Number of combinations of " + std::to_string(size) + " from " + std::to_string(n) + " doesn't fit into 64 bits");
+        result = (uint64_t) next;
+    }
+    return result;
+}
+
+// Next bitmask with the same number of set bits (Gosper's hack),
+// starting from the lowest mask this enumerates combinations in colexicographic order.
+uint64_t nextCombinationMask(uint64_t mask) {
+    uint64_t lowestBit = mask & (0 - mask);
+    uint64_t ripple = mask + lowestBit;
+    return ripple | (((mask ^ ripple) >> 2) / lowestBit);
+}
+
+// Position of combination mask in colexicographic order, i.e. in the order of nextCombinationMask().
+uint64_t rankOf(uint64_t mask) {
+    uint64_t rank = 0;
+    for (uint64_t i = 1; mask != 0; i++, mask &= mask - 1) {
+        rank += countCombinations(__builtin_ctzll(mask), i);
+    }
+    return rank;
+}
+
+// Mask of size-combination of n items which has the given rank, the inverse of rankOf().
+uint64_t unrank(int n, int size, uint64_t rank) {
+    if (n < 0 || n > 64 || size < 0 || size > n)
+        throw std::invalid_argument("Cannot unrank combination of " + std::to_string(size) + " from " + std::to_string(n));
+    if (rank >= countCombinations(n, size))
+        throw std::out_of_range("Rank " + std::to_string(rank) + " is out of range");
+
+    uint64_t mask = 0;
+    int position = n;
+    for (int i = size; i > 0; i--) {
+        uint64_t count;
+        do {
+            count = countCombinations(--position, i);
+        } while (count > rank);
+        mask |= 1ull << position;
+        rank -= count;
+    }
+    return mask;
+}
+
+// Lazily enumerates size-combinations of up to 64 items in colexicographic order of their bitmasks.
+// Items of the current combination are written into a reused buffer so iteration doesn't allocate.
+//   for (CombinationEnumerator<int> it(2, items); it.next();) use(it.current());
+template<typename T>
+class CombinationEnumerator {
+public:
+    CombinationEnumerator(int size, const Vector<T> &items, uint64_t firstRank = 0):
+            items(checked(size, items)), size(size), total(countCombinations(items.size(), size)), nextRank(firstRank) {
+        buffer.reserve(size);
+        if (nextRank < total) combinationMask = unrank(sizeOf(items), size, nextRank);
+    }
+
+    bool next() {
+        if (nextRank >= total) return false;
+        if (started) combinationMask = nextCombinationMask(combinationMask);
+        started = true;
+        nextRank++;
+
+        buffer.clear();
+        for (uint64_t bits = combinationMask; bits != 0; bits &= bits - 1) {
+            buffer.push_back(items[__builtin_ctzll(bits)]);
+        }
+        return true;
+    }
+
+    const Vector<T> &current() const { return buffer; }
+    uint64_t mask() const { return combinationMask; }
+    uint64_t rank() const { return nextRank - 1; }
+    uint64_t count() const { return total; }
+
+private:
+    // Runs before countCombinations() in the initializer list.
+    static const Vector<T> &checked(int size, const Vector<T> &items) {
+        if (items.size() > 64)
+            throw std::invalid_argument("Cannot enumerate combinations of more than 64 items but was " + std::to_string(items.size()));
+        if (size < 0) throw std::invalid_argument("Combination size should be >= 0 but was " + std::to_string(size));
+        return items;
+    }
+
+    Vector<T> items;
+    Vector<T> buffer;
+    int size;
+    uint64_t total;
+    uint64_t nextRank;
+    uint64_t combinationMask = 0;
+    bool started = false;
+};
+
+template<typename Sequence>
+CombinationEnumerator<ElementOf<Sequence>> lazyCombinations(int size, const Sequence &sequence, uint64_t firstRank = 0) {
+    return CombinationEnumerator<ElementOf<Sequence>>(size, Vector<ElementOf<Sequence>>(std::begin(sequence), std::end(sequence)), firstRank);
+}
+
+// Calls accumulate(partialResult, mask) for every size-combination mask of n items and combines partial results.
+// The rank space is split into chunks which threads take in turn, each chunk starts with unrank() and
+// walks its masks with Gosper's hack. Partial results of chunks are combined in rank order.
+template<typename R, typename Accumulate, typename Combine>
+R reduceCombinations(int n, int size, R identity, Accumulate accumulate, Combine combine,
+                     unsigned threadCount = defaultThreadCount()) {
+    if (n > 64) throw std::invalid_argument("Cannot enumerate combinations of more than 64 items but was " + std::to_string(n));
+    uint64_t total = countCombinations(n, size);
+    if (total == 0) return identity;
+
+    threadCount = std::max(1u, threadCount);
+    size_t chunkCount = (size_t) std::min<uint64_t>(total, (uint64_t) threadCount * 64);
+    std::deque<R> chunkResults(chunkCount, identity); // unlike Vector<bool>, elements can be written from different threads
+    std::atomic<size_t> nextChunk(0);
+    parallelChunks(threadCount, threadCount, [&](unsigned, size_t, size_t) {
+        for (size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+            uint64_t fromRank = (uint64_t) ((unsigned __int128) total * chunk / chunkCount);
+            uint64_t toRank = (uint64_t) ((unsigned __int128) total * (chunk + 1) / chunkCount);
+            uint64_t mask = unrank(n, size, fromRank);
+            R partialResult = identity;
+            for (uint64_t rank = fromRank; rank < toRank; rank++) {
+                accumulate(partialResult, mask);
+                if (rank + 1 < toRank) mask = nextCombinationMask(mask);
+            }
+            chunkResults[chunk] = std::move(partialResult);
+        }
+    });
+
+    R result = identity;
+    for (auto &chunkResult : chunkResults) {
+        result = combine(result, chunkResult);
+    }
+    return result;
+}
+
+template<typename F>
+void forEachCombinationParallel(int n, int size, F f, unsigned threadCount = defaultThreadCount()) {
+    reduceCombinations(n, size, 0, [&](int &, uint64_t mask) { f(mask); }, [](int, int) { return 0; }, threadCount);
+}
+
+template<typename T, typename Allocator>
+List<T, Allocator> tailOf(const List<T, Allocator> &list) {
+    return std::get<0>(removeAt(0, list));
+}
+
+template<typename T, typename Allocator>
+List<T, Allocator> tailOf(List<T, Allocator> &&list) {
+    removeAtInPlace(0, list);
+    return std::move(list);
+}
+
+template<typename T, typename Allocator>
+NestedOf<NestedOf<List<T, Allocator>>> group(List<int> groupSizes, const List<T, Allocator> &list) {
+    auto result = emptyLike<NestedOf<NestedOf<List<T, Allocator>>>>(list);
+    if (groupSizes.empty() || list.empty()) {
+        result.emplace_back();
+        return result;
+    }
+
+    int groupSize = groupSizes.front();
+    auto itemCombinations = combinations(groupSize, list);
+    for (auto &combination : itemCombinations) {
+        auto listCopy = copyOf(list);
+        for (auto item : combination) {
+            listCopy.remove(item);
+        }
+        auto subResult = group(tailOf(groupSizes), listCopy);
+        for (auto &subCombinations : subResult) {
+            result.push_back(insertAt(0, combination, subCombinations));
+        }
+    }
+
+    return result;
+}
+
+uint64_t lowestCombinationMask(int size) {
+    return size >= 64 ? ~0ull : (1ull << size) - 1;
+}
+
+// Spreads bits of mask over set bits of positions, i.e. bit i of mask goes to the i-th set bit of positions.
+uint64_t depositBits(uint64_t mask, uint64_t positions) {
+    uint64_t result = 0;
+    for (; mask != 0 && positions != 0; mask >>= 1, positions &= positions - 1) {
+        if (mask & 1) result |= positions & (0 - positions);
+    }
+    return result;
+}
+
+// Number of ways to pick disjoint groups of the given sizes from n items,
+// i.e. the multinomial n! / (size1! * size2! * ... * (n - sum of sizes)!). Throws std::overflow_error above 64 bits.
+// Number of ways to fill all groups from n items, 0 if group sizes add up to more than n.
+uint64_t countGroupings(int n, const Vector<int> &groupSizes) {
+    uint64_t result = 1;
+    int remaining = n;
+    for (int size : groupSizes) {
+        if (size < 0 || size > remaining) return 0;
+        uint64_t count = countCombinations(remaining, size);
+        if (result > UINT64_MAX / count)
+            throw std::overflow_error("Number of groupings of " + std::to_string(n) + " items doesn't fit into 64 bits");
+        result *= count;
+        remaining -= size;
+    }
+    return result;
+}
+
+// Lazily enumerates the same groupings as group() using bitmasks of used items for up to 64 items.
+// Unlike group(), which stops at the group where items run out (e.g. group({2, 2, 1}, {1, 2, 3, 4}) gives
+// 6 groupings of two groups), every group must be filled, so group sizes adding up to more items give no groupings.
+// The last group changes fastest and each group goes through its combinations of remaining items in
+// colexicographic order, so a grouping can be unranked to start from any rank (e.g. to shard work across threads).
+template<typename T>
+class GroupEnumerator {
+public:
+    GroupEnumerator(const Vector<int> &groupSizes, const Vector<T> &items, uint64_t firstRank = 0):
+            items(items), groupSizes(groupSizes), buffer(groupSizes.size()), nextRank(firstRank) {
+        if (items.size() > 64)
+            throw std::invalid_argument("Cannot enumerate groupings of more than 64 items but was " + std::to_string(items.size()));
+        total = countGroupings(sizeOf(items), groupSizes);
+
+        int remaining = sizeOf(items);
+        for (int size : groupSizes) {
+            levelCounts.push_back(total == 0 ? 0 : countCombinations(remaining, size));
+            remaining -= size;
+        }
+        digits.assign(groupSizes.size(), 0);
+        relativeMasks.assign(groupSizes.size(), 0);
+        absoluteMasks.assign(groupSizes.size(), 0);
+        freeBefore.assign(groupSizes.size(), 0);
+        if (nextRank < total) unrankInto(nextRank);
+    }
+
+    bool next() {
+        if (nextRank >= total) return false;
+        if (started) advance();
+        started = true;
+        nextRank++;
+
+        for (size_t level = 0; level < groupSizes.size(); level++) {
+            buffer[level].clear();
+            for (uint64_t bits = absoluteMasks[level]; bits != 0; bits &= bits - 1) {
+                buffer[level].push_back(items[__builtin_ctzll(bits)]);
+            }
+        }
+        return true;
+    }
+
+    const Vector<Vector<T>> &current() const { return buffer; }
+    const Vector<uint64_t> &masks() const { return absoluteMasks; }
+    uint64_t rank() const { return nextRank - 1; }
+    uint64_t count() const { return total; }
+
+private:
+    void unrankInto(uint64_t rank) {
+        for (size_t level = groupSizes.size(); level-- > 0;) {
+            digits[level] = rank % levelCounts[level];
+            rank /= levelCounts[level];
+            relativeMasks[level] = unrank(sizeOf(items) - usedBefore(level), groupSizes[level], digits[level]);
+        }
+        updateAbsoluteMasks(0);
+    }
+
+    void advance() {
+        size_t level = groupSizes.size() - 1;
+        while (++digits[level] == levelCounts[level]) {
+            digits[level] = 0;
+            relativeMasks[level] = lowestCombinationMask(groupSizes[level]);
+            level--;
+        }
+        relativeMasks[level] = nextCombinationMask(relativeMasks[level]);
+        updateAbsoluteMasks(level);
+    }
+
+    void updateAbsoluteMasks(size_t fromLevel) {
+        uint64_t free = fromLevel == 0 ? lowestCombinationMask(sizeOf(items)) : freeBefore[fromLevel];
+        for (size_t level = fromLevel; level < groupSizes.size(); level++) {
+            freeBefore[level] = free;
+            absoluteMasks[level] = depositBits(relativeMasks[level], free);
+            free &= ~absoluteMasks[level];
+        }
+    }
+
+    int usedBefore(size_t level) const {
+        return std::accumulate(groupSizes.begin(), groupSizes.begin() + level, 0);
+    }
+
+    Vector<T> items;
+    Vector<int> groupSizes;
+    Vector<Vector<T>> buffer;
+    Vector<uint64_t> levelCounts, digits, relativeMasks, absoluteMasks, freeBefore;
+    uint64_t total;
+    uint64_t nextRank;
+    bool started = false;
+};
+
+template<typename Sequence>
+GroupEnumerator<ElementOf<Sequence>> lazyGroup(const List<int> &groupSizes, const Sequence &sequence, uint64_t firstRank = 0) {
+    return GroupEnumerator<ElementOf<Sequence>>(
+            Vector<int>(groupSizes.begin(), groupSizes.end()),
+            Vector<ElementOf<Sequence>>(std::begin(sequence), std::end(sequence)),
+            firstRank);
+}
+
+// Stable counting sort by small integer keys (one per element in list order).
+// Nodes are spliced into per-key buckets so elements themselves are never copied or compared.
+template<typename T, typename Allocator>
+List<T, Allocator> countingSortBy(List<T, Allocator> &&list, const Vector<size_t> &keys, size_t maxKey) {
+    Vector<List<T, Allocator>> buckets;
+    buckets.reserve(maxKey + 1);
+    for (size_t key = 0; key <= maxKey; key++) {
+        buckets.push_back(emptyLike<List<T, Allocator>>(list));
+    }
+    for (size_t key : keys) {
+        buckets[key].splice(buckets[key].end(), list, list.begin());
+    }
+    for (auto &bucket : buckets) {
+        list.splice(list.end(), bucket);
+    }
+    return std::move(list);
+}
+
+template<typename Sequence>
+Vector<size_t> lengthsOf(const Sequence &sequences) {
+    Vector<size_t> lengths;
+    lengths.reserve(sequences.size());
+    for (auto &item : sequences) lengths.push_back(item.size());
+    return lengths;
+}
+
+template<typename T, typename Allocator, typename OuterAllocator>
+List<List<T, Allocator>, OuterAllocator> sortByLength(List<List<T, Allocator>, OuterAllocator> &&list) {
+    Vector<size_t> lengths = lengthsOf(list);
+    size_t maxLength = lengths.empty() ? 0 : *std::max_element(lengths.begin(), lengths.end());
+    return countingSortBy(std::move(list), lengths, maxLength);
+}
+
+template<typename T, typename Allocator, typename OuterAllocator>
+List<List<T, Allocator>, OuterAllocator> sortByLength(const List<List<T, Allocator>, OuterAllocator> &list) {
+    return sortByLength(copyOf(list));
+}
+
+template<typename T, typename Allocator, typename OuterAllocator>
+List<List<T, Allocator>, OuterAllocator> sortByLengthFrequency(List<List<T, Allocator>, OuterAllocator> &&list) {
+    Vector<size_t> keys = lengthsOf(list);
+    size_t maxLength = keys.empty() ? 0 : *std::max_element(keys.begin(), keys.end());
+    Vector<size_t> frequencyByLength(maxLength + 1, 0);
+    for (size_t length : keys) frequencyByLength[length]++;
+
+    // Use rank of frequency as a key so that there are at most maxLength + 1 buckets.
+    Vector<size_t> frequencies = frequencyByLength;
+    std::sort(frequencies.begin(), frequencies.end());
+    frequencies.erase(std::unique(frequencies.begin(), frequencies.end()), frequencies.end());
+    Vector<size_t> rankByLength(maxLength + 1);
+    for (size_t length = 0; length <= maxLength; length++) {
+        rankByLength[length] = std::lower_bound(frequencies.begin(), frequencies.end(), frequencyByLength[length]) - frequencies.begin();
+    }
+    for (size_t &key : keys) key = rankByLength[key];
+    return countingSortBy(std::move(list), keys, frequencies.size() - 1);
+}
+
+template<typename T, typename Allocator, typename OuterAllocator>
+List<List<T, Allocator>, OuterAllocator> sortByLengthFrequency(const List<List<T, Allocator>, OuterAllocator> &list) {
+    return sortByLengthFrequency(copyOf(list));
+}
+
+uint64_t integerSqrt(uint64_t n) {
+    uint64_t result = (uint64_t) std::sqrt((double) n);
+    while (result > 0 && result > n / result) result--;
+    while (result + 1 <= n / (result + 1)) result++;
+    return result;
+}
+
+// Odd-only sieve of Eratosthenes for primes used to sieve larger ranges.
+Vector<uint32_t> smallPrimesUpTo(uint32_t n) {
+    Vector<uint32_t> result;
+    if (n >= 2) result.push_back(2);
+    Vector<bool> composite(n / 2 + 1, false); // composite[i] is for 2 * i + 1
+    for (uint64_t i = 1; 2 * i + 1 <= n; i++) {
+        if (composite[i]) continue;
+        uint64_t prime = 2 * i + 1;
+        result.push_back((uint32_t) prime);
+        for (uint64_t j = prime * prime / 2; j <= n / 2; j += prime) {
+            composite[j] = true;
+        }
+    }
+    return result;
+}
+
+// Mod-30 wheel, byte i of a sieve has bits for 30 * i + wheelResidues[bit], i.e. only numbers coprime to 2, 3 and 5.
+const uint8_t wheelResidues[8] = {1, 7, 11, 13, 17, 19, 23, 29};
+const int8_t wheelBitOf[30] = {
+        -1, 0, -1, -1, -1, -1, -1, 1, -1, -1, -1, 2, -1, 3, -1, -1, -1, 4, -1, 5, -1, -1, -1, 6, -1, -1, -1, -1, -1, 7
+};
+const size_t sieveSegmentBytes = 32 * 1024; // fits into L1 cache and covers ~10^6 numbers
+const size_t sieveBlockBytes = 32 * sieveSegmentBytes;
+
+// Sets bits of composite numbers for bytes [fromByte, toByte) of the wheel in L1-sized segments.
+// Multiples p * k of a prime with k in the same wheel residue class are p bytes apart and share a bit,
+// so each prime is crossed off in 8 strided lanes which continue from one segment to the next.
+void sieveWheelBlock(uint64_t fromByte, uint64_t toByte, const Vector<uint32_t> &basePrimes, uint8_t *composites) {
+    std::fill(composites, composites + (toByte - fromByte), 0);
+    Vector<uint64_t> nextBytes;
+    Vector<uint32_t> strides;
+    Vector<uint8_t> masks;
+    for (uint32_t prime : basePrimes) {
+        if (prime < 7) continue;
+        if ((uint64_t) prime * prime >= 30 * toByte) break;
+        uint64_t minMultiplier = std::max<uint64_t>(prime, (30 * fromByte + prime - 1) / prime);
+        for (uint8_t residue : wheelResidues) {
+            uint64_t multiplier = minMultiplier + (residue + 30 - minMultiplier % 30) % 30;
+            nextBytes.push_back(prime * multiplier / 30);
+            strides.push_back(prime);
+            masks.push_back((uint8_t) (1 << wheelBitOf[prime * residue % 30]));
+        }
+    }
+    for (uint64_t segment = fromByte; segment < toByte; segment += sieveSegmentBytes) {
+        uint64_t segmentEnd = std::min<uint64_t>(segment + sieveSegmentBytes, toByte);
+        for (size_t lane = 0; lane < nextBytes.size(); lane++) {
+            uint64_t byte = nextBytes[lane];
+            for (; byte < segmentEnd; byte += strides[lane]) {
+                composites[byte - fromByte] |= masks[lane];
+            }
+            nextBytes[lane] = byte;
+        }
+    }
+}
+
+// Calls onPrime(p) in increasing order for each prime p in [from, to] with the segmented sieve of Eratosthenes.
+// Each round sieves threadCount consecutive blocks in parallel and then streams their primes,
+// so memory use doesn't depend on the size of the range.
+template<typename F>
+void forEachPrimeInRange(uint64_t from, uint64_t to, F onPrime, unsigned threadCount = defaultThreadCount()) {
+    for (uint64_t prime : {2, 3, 5}) {
+        if (from <= prime && prime <= to) onPrime(prime);
+    }
+    if (to < 7 || from > to) return;
+
+    auto basePrimes = smallPrimesUpTo((uint32_t) integerSqrt(to));
+    uint64_t firstByte = from / 30;
+    uint64_t lastByte = to / 30 + 1;
+    uint64_t minPrime = std::max<uint64_t>(from, 7);
+    threadCount = std::max(1u, threadCount);
+    Vector<Vector<uint8_t>> blocks(threadCount);
+    for (uint64_t roundStart = firstByte; roundStart < lastByte; roundStart += sieveBlockBytes * threadCount) {
+        unsigned blockCount = (unsigned) std::min<uint64_t>(threadCount, (lastByte - roundStart + sieveBlockBytes - 1) / sieveBlockBytes);
+        parallelChunks(blockCount, blockCount, [&](unsigned block, size_t, size_t) {
+            uint64_t blockStart = roundStart + block * sieveBlockBytes;
+            blocks[block].resize(sieveBlockBytes);
+            sieveWheelBlock(blockStart, std::min<uint64_t>(blockStart + sieveBlockBytes, lastByte), basePrimes, blocks[block].data());
+        });
+        for (unsigned block = 0; block < blockCount; block++) {
+            uint64_t blockStart = roundStart + block * sieveBlockBytes;
+            uint64_t blockEnd = std::min<uint64_t>(blockStart + sieveBlockBytes, lastByte);
+            for (uint64_t byte = blockStart; byte < blockEnd; byte++) {
+                for (unsigned bits = (uint8_t) ~blocks[block][byte - blockStart]; bits != 0; bits &= bits - 1) {
+                    uint64_t n = 30 * byte + wheelResidues[__builtin_ctz(bits)];
+                    if (n >= minPrime && n <= to) onPrime(n);
+                }
+            }
+        }
+    }
+}
+
+// Numbers below ~2^20 are looked up in a wheel sieve, larger ones use trial division by primes up to sqrt(INT_MAX).
+bool isPrime(int n) {
+    static const uint64_t sievedBytes = (1 << 20) / 30;
+    static const Vector<uint8_t> composites = [] {
+        Vector<uint8_t> result(sievedBytes);
+        sieveWheelBlock(0, sievedBytes, smallPrimesUpTo((uint32_t) integerSqrt(30 * sievedBytes)), result.data());
+        return result;
+    }();
+    static const Vector<uint32_t> primes = smallPrimesUpTo(46341);
+    if (n < 2) return false;
+    if (n % 2 == 0 || n % 3 == 0 || n % 5 == 0) return n == 2 || n == 3 || n == 5;
+    if ((uint64_t) n < 30 * sievedBytes) return (composites[n / 30] & (1 << wheelBitOf[n % 30])) == 0;
+    for (uint32_t prime : primes) {
+        if ((int64_t) prime * prime > n) break;
+        if (n % prime == 0) return false;
+    }
+    return true;
+}
+
+// Modular arithmetic for odd 64-bit modulus n with numbers stored as a * 2^64 mod n,
+// so that multiplication needs 128-bit products but no division.
+class Montgomery {
+public:
+    explicit Montgomery(uint64_t n = 1): n(n) {
+        inverse = n; // correct to 3 bits for odd n, each Newton iteration doubles the number of bits
+        for (int i = 0; i < 5; i++) inverse *= 2 - n * inverse;
+        uint64_t r = (0 - n) % n;
+        r2 = (uint64_t) ((unsigned __int128) r * r % n);
+        one = r;
+        minusOne = n - r;
+    }
+
+    uint64_t multiply(uint64_t a, uint64_t b) const {
+        unsigned __int128 product = (unsigned __int128) a * b;
+        uint64_t high = (uint64_t) (product >> 64);
+        uint64_t correction = (uint64_t) (((unsigned __int128) ((uint64_t) product * inverse) * n) >> 64);
+        return high >= correction ? high - correction : high - correction + n;
+    }
+    uint64_t add(uint64_t a, uint64_t b) const { return a >= n - b ? a - (n - b) : a + b; }
+    uint64_t toMontgomery(uint64_t a) const { return multiply(a % n, r2); }
+
+    uint64_t one, minusOne;
+
+private:
+    uint64_t n, inverse, r2;
+};
+
+const uint32_t trialDivisionPrimes[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53};
+
+// 0 if n is composite, 1 if n is prime and -1 if it needs Miller-Rabin test.
+int trialDivisionVerdict(uint64_t n) {
+    if (n < 2) return 0;
+    for (uint32_t prime : trialDivisionPrimes) {
+        if (n % prime == 0) return n == prime;
+    }
+    return n < 59 * 59 ? 1 : -1;
+}
+
+// Witnesses which make Miller-Rabin test deterministic for all 64-bit numbers (found by Jim Sinclair).
+const uint64_t millerRabinWitnesses[] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+
+// Tests Lanes odd numbers at once so that multiplications for different numbers overlap in the CPU pipeline.
+// Uses witnesses in [firstWitness, lastWitness) so that all of them are needed to prove that a number is prime.
+template<size_t Lanes>
+void millerRabin(const uint64_t *numbers, bool *results, size_t firstWitness = 0, size_t lastWitness = std::size(millerRabinWitnesses)) {
+    Montgomery montgomery[Lanes];
+    uint64_t d[Lanes];
+    int s[Lanes];
+    bool composite[Lanes];
+    uint64_t allD = 0;
+    int maxS = 0;
+    for (size_t lane = 0; lane < Lanes; lane++) {
+        montgomery[lane] = Montgomery(numbers[lane]);
+        s[lane] = __builtin_ctzll(numbers[lane] - 1);
+        d[lane] = (numbers[lane] - 1) >> s[lane];
+        composite[lane] = false;
+        allD |= d[lane];
+        maxS = std::max(maxS, s[lane]);
+    }
+    int bitCount = 64 - __builtin_clzll(allD);
+
+    for (size_t witnessIndex = firstWitness; witnessIndex < lastWitness; witnessIndex++) {
+        uint64_t witness = millerRabinWitnesses[witnessIndex];
+        uint64_t base[Lanes], x[Lanes];
+        bool passed[Lanes];
+        for (size_t lane = 0; lane < Lanes; lane++) {
+            uint64_t a = witness % numbers[lane];
+            passed[lane] = composite[lane] || a == 0;
+            base[lane] = montgomery[lane].toMontgomery(a);
+            x[lane] = montgomery[lane].one;
+        }
+        for (int bit = bitCount - 1; bit >= 0; bit--) {
+            for (size_t lane = 0; lane < Lanes; lane++) {
+                x[lane] = montgomery[lane].multiply(x[lane], x[lane]);
+                uint64_t product = montgomery[lane].multiply(x[lane], base[lane]);
+                x[lane] = ((d[lane] >> bit) & 1) ? product : x[lane];
+            }
+        }
+        for (size_t lane = 0; lane < Lanes; lane++) {
+            passed[lane] = passed[lane] || x[lane] == montgomery[lane].one || x[lane] == montgomery[lane].minusOne;
+        }
+        for (int round = 1; round < maxS; round++) {
+            for (size_t lane = 0; lane < Lanes; lane++) {
+                if (passed[lane] || round >= s[lane]) continue;
+                x[lane] = montgomery[lane].multiply(x[lane], x[lane]);
+                passed[lane] = x[lane] == montgomery[lane].minusOne;
+            }
+        }
+        bool allComposite = true;
+        for (size_t lane = 0; lane < Lanes; lane++) {
+            composite[lane] = composite[lane] || !passed[lane];
+            allComposite = allComposite && composite[lane];
+        }
+        if (allComposite) break;
+    }
+    for (size_t lane = 0; lane < Lanes; lane++) {
+        results[lane] = !composite[lane];
+    }
+}
+
+// Deterministic for all 64-bit numbers.
+bool isPrime64(uint64_t n) {
+    int verdict = trialDivisionVerdict(n);
+    if (verdict >= 0) return verdict == 1;
+    bool result;
+    millerRabin<1>(&n, &result);
+    return result;
+}
+
+// Tests candidates in groups of 4 with the first witness, which rejects most composites,
+// and then tests the remaining candidates with the rest of witnesses.
+void isPrime64(const uint64_t *candidates, size_t count, bool *results) {
+    Vector<size_t> pending;
+    for (size_t i = 0; i < count; i++) {
+        int verdict = trialDivisionVerdict(candidates[i]);
+        results[i] = verdict == 1;
+        if (verdict < 0) pending.push_back(i);
+    }
+
+    const size_t lanes = 4;
+    auto test = [&](size_t firstWitness, size_t lastWitness) {
+        size_t i = 0;
+        for (; i + lanes <= pending.size(); i += lanes) {
+            uint64_t numbers[lanes];
+            bool laneResults[lanes];
+            for (size_t lane = 0; lane < lanes; lane++) numbers[lane] = candidates[pending[i + lane]];
+            millerRabin<lanes>(numbers, laneResults, firstWitness, lastWitness);
+            for (size_t lane = 0; lane < lanes; lane++) results[pending[i + lane]] = laneResults[lane];
+        }
+        for (; i < pending.size(); i++) {
+            millerRabin<1>(candidates + pending[i], results + pending[i], firstWitness, lastWitness);
+        }
+        pending.erase(std::remove_if(pending.begin(), pending.end(), [&](size_t i) { return !results[i]; }), pending.end());
+    };
+    test(0, 1);
+    test(1, std::size(millerRabinWitnesses));
+}
+
+Vector<bool> isPrime64(const Vector<uint64_t> &candidates) {
+    std::unique_ptr<bool[]> results(new bool[candidates.size()]);
+    isPrime64(candidates.data(), candidates.size(), results.get());
+    return Vector<bool>(results.get(), results.get() + candidates.size());
+}
+
+int gcd(int a, int b) {
+    if (b < a) {
+        int tmp = a;
+        a = b;
+        b = tmp;
+    }
+    while (b % a != 0) {
+        int reminder = b % a;
+        b = a;
+        a = reminder;
+    }
+    return a;
+}
+
+bool areCoprime(int a, int b) {
+    return gcd(a, b) == 1;
+}
+
+int totient(int n) {
     int result = 0;
     for (int i = 1; i <= n; i++) {
         if (areCoprime(i, n)) result++;
@@ -447,18 +2323,90 @@ int totient(int n) {
     return result;
 }
 
-List<int> primeFactorsOf(int n) {
-    if (n == 1) return {1};
-    List<int> result;
-    while (n != 1) {
-        for (int factor = 2; factor <= n; factor++) {
-            if (isPrime(factor) && n % factor == 0) {
-                result.push_back(factor);
-                n = n / factor;
-                break;
+// Finds a non-trivial factor of odd composite n with Pollard's rho using Brent's cycle detection.
+// Differences are multiplied together so that there is one gcd per batch of steps instead of one per step.
+uint64_t pollardRhoBrent(uint64_t n) {
+    const uint64_t batchSize = 128;
+    Montgomery montgomery(n);
+    for (uint64_t c = 1;; c++) {
+        uint64_t increment = montgomery.toMontgomery(c);
+        auto f = [&](uint64_t x) { return montgomery.add(montgomery.multiply(x, x), increment); };
+        auto distance = [](uint64_t a, uint64_t b) { return a > b ? a - b : b - a; };
+
+        uint64_t x = 0, y = montgomery.toMontgomery(2), ys = y;
+        uint64_t product = montgomery.one;
+        uint64_t factor = 1;
+        for (uint64_t r = 1; factor == 1; r *= 2) {
+            x = y;
+            for (uint64_t i = 0; i < r; i++) y = f(y);
+            for (uint64_t k = 0; k < r && factor == 1; k += batchSize) {
+                ys = y;
+                for (uint64_t i = 0; i < std::min(batchSize, r - k); i++) {
+                    y = f(y);
+                    product = montgomery.multiply(product, distance(x, y));
+                }
+                factor = std::gcd(product, n);
             }
         }
+        if (factor == n) {
+            // The batch went past the cycle, repeat its steps one at a time.
+            do {
+                ys = f(ys);
+                factor = std::gcd(distance(x, ys), n);
+            } while (factor == 1);
+        }
+        if (factor != n) return factor;
+    }
+}
+
+void primeFactorsInto(uint64_t n, Vector<uint64_t> &factors) {
+    if (n == 1) return;
+    if (isPrime64(n)) {
+        factors.push_back(n);
+        return;
+    }
+    uint64_t factor = pollardRhoBrent(n);
+    primeFactorsInto(factor, factors);
+    primeFactorsInto(n / factor, factors);
+}
+
+// Prime factors in ascending order with repetitions, e.g. 12 -> {2, 2, 3}, and no factors for 1.
+// Uses trial division by small primes, then Miller-Rabin and Pollard's rho for the rest.
+Vector<uint64_t> primeFactorsOf64(uint64_t n) {
+    if (n == 0) throw std::invalid_argument("Cannot factorize 0");
+    Vector<uint64_t> result;
+    for (uint32_t prime : trialDivisionPrimes) {
+        while (n % prime == 0) {
+            result.push_back(prime);
+            n /= prime;
+        }
     }
+    primeFactorsInto(n, result);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+// Unlike primeFactorsOf64(), gives {1} for 1 as the original solution of P35 does.
+template<typename Sequence>
+void appendPrimeFactorsOf(int n, Sequence &result) {
+    if (n <= 0) throw std::invalid_argument("Cannot factorize " + std::to_string(n));
+    if (n == 1) {
+        result.push_back(1);
+        return;
+    }
+    auto factors = primeFactorsOf64((uint64_t) n);
+    result.insert(result.end(), factors.begin(), factors.end());
+}
+
+List<int> primeFactorsOf(int n) {
+    List<int> result;
+    appendPrimeFactorsOf(n, result);
+    return result;
+}
+
+std::pmr::list<int> primeFactorsOf(int n, std::pmr::memory_resource *resource) {
+    std::pmr::list<int> result(resource);
+    appendPrimeFactorsOf(n, result);
     return result;
 }
 
@@ -475,6 +2423,13 @@ std::unordered_map<int, int> primeFactorMultiplicityOf(int n) {
     return result;
 }
 
+std::unordered_map<uint64_t, int> primeFactorMultiplicityOf64(uint64_t n) {
+    std::unordered_map<uint64_t, int> result;
+    for (auto factor : primeFactorsOf64(n)) {
+        result[factor]++;
+    }
+    return result;
+}
 
 int fastTotient(int n) {
     int result = 1;
@@ -487,11 +2442,170 @@ int fastTotient(int n) {
     return result;
 }
 
+uint64_t fastTotient64(uint64_t n) {
+    uint64_t result = 1;
+    for (auto &entry : primeFactorMultiplicityOf64(n)) {
+        uint64_t prime = entry.first;
+        result *= prime - 1;
+        for (int i = 1; i < entry.second; i++) result *= prime;
+    }
+    return result;
+}
+
+// Euler's totient of every number in [from, to] sieved in segments which fit into L2 cache.
+// Totient starts as n and for each prime p <= sqrt(to) dividing n is multiplied by (1 - 1/p) while p is divided out of n,
+// so that what remains of n is either 1 or its only prime factor above sqrt(to).
+Vector<uint32_t> totientsInRange(uint32_t from, uint32_t to, unsigned threadCount = defaultThreadCount()) {
+    if (from > to) return {};
+    const size_t segmentSize = 64 * 1024;
+    auto primes = smallPrimesUpTo((uint32_t) integerSqrt(to));
+    Vector<uint32_t> result((size_t) to - from + 1);
+    parallelChunks(result.size(), threadCount, [&](unsigned, size_t chunkFrom, size_t chunkTo) {
+        Vector<uint32_t> remaining(segmentSize);
+        for (size_t segment = chunkFrom; segment < chunkTo; segment += segmentSize) {
+            size_t segmentEnd = std::min(segment + segmentSize, chunkTo);
+            uint64_t low = from + segment;
+            uint64_t high = from + segmentEnd - 1;
+            uint32_t *totients = result.data() + segment;
+            for (size_t i = 0; i < segmentEnd - segment; i++) {
+                totients[i] = remaining[i] = (uint32_t) (low + i);
+            }
+            for (uint64_t prime : primes) {
+                if (prime * prime > high) break;
+                uint64_t first = std::max(prime, (low + prime - 1) / prime * prime);
+                for (uint64_t multiple = first; multiple <= high; multiple += prime) {
+                    size_t i = multiple - low;
+                    totients[i] -= totients[i] / prime;
+                    do {
+                        remaining[i] /= prime;
+                    } while (remaining[i] % prime == 0);
+                }
+            }
+            for (size_t i = 0; i < segmentEnd - segment; i++) {
+                if (remaining[i] > 1) totients[i] -= totients[i] / remaining[i];
+            }
+        }
+    });
+    return result;
+}
+
+// Euler's totient of every number in [0, n], with one thread sieved in place.
+Vector<uint32_t> totientsUpTo(uint32_t n, unsigned threadCount = 1) {
+    if (threadCount > 1) return totientsInRange(0, n, threadCount);
+
+    Vector<uint32_t> result((size_t) n + 1);
+    std::iota(result.begin(), result.end(), 0);
+    for (uint64_t i = 2; i <= n; i++) {
+        if (result[i] != i) continue; // not a prime
+        for (uint64_t multiple = i; multiple <= n; multiple += i) {
+            result[multiple] -= result[multiple] / i;
+        }
+    }
+    return result;
+}
+
+// Smallest prime factor of every number up to limit for factorization in O(log n) steps without allocation.
+// Stores one uint32_t per odd number since the smallest prime factor of even numbers is always 2.
+class SmallestPrimeFactorTable {
+public:
+    // Uses linear sieve with one thread, otherwise sieves disjoint parts of the table on separate threads.
+    explicit SmallestPrimeFactorTable(uint32_t limit, unsigned threadCount = 1): limit(limit), factors(limit / 2 + 1, 0) {
+        if (threadCount <= 1) {
+            buildWithLinearSieve();
+        } else {
+            buildInParallel(threadCount);
+        }
+    }
+
+    uint32_t smallestPrimeFactorOf(uint32_t n) const {
+        if (n < 2 || n > limit)
+            throw std::out_of_range("Number " + std::to_string(n) + " is not in [2, " + std::to_string(limit) + "]");
+        return n % 2 == 0 ? 2 : factors[n / 2];
+    }
+
+    // Calls f(prime) for each prime factor of n in ascending order with repetitions.
+    template<typename F>
+    void forEachPrimeFactor(uint32_t n, F f) const {
+        while (n > 1) {
+            uint32_t prime = smallestPrimeFactorOf(n);
+            f(prime);
+            n /= prime;
+        }
+    }
+
+    // Writes prime factors of n to output which must have space for 32 items and returns their number.
+    size_t primeFactorsOf(uint32_t n, uint32_t *output) const {
+        size_t count = 0;
+        forEachPrimeFactor(n, [&](uint32_t prime) { output[count++] = prime; });
+        return count;
+    }
+
+    uint32_t totient(uint32_t n) const {
+        uint32_t result = n;
+        uint32_t lastPrime = 0;
+        forEachPrimeFactor(n, [&](uint32_t prime) {
+            if (prime != lastPrime) result -= result / prime;
+            lastPrime = prime;
+        });
+        return result;
+    }
+
+    size_t memoryBytes() const { return sizeof(*this) + factors.capacity() * sizeof(uint32_t); }
+
+private:
+    // Each odd composite is written once as prime * i where prime is its smallest prime factor.
+    void buildWithLinearSieve() {
+        Vector<uint32_t> primes;
+        for (uint64_t i = 3; i <= limit; i += 2) {
+            if (factors[i / 2] == 0) {
+                factors[i / 2] = (uint32_t) i;
+                primes.push_back((uint32_t) i);
+            }
+            for (uint32_t prime : primes) {
+                if (prime > factors[i / 2] || prime * i > limit) break;
+                factors[prime * i / 2] = prime;
+            }
+        }
+    }
+
+    void buildInParallel(unsigned threadCount) {
+        auto primes = smallPrimesUpTo((uint32_t) integerSqrt(limit));
+        parallelChunks(factors.size(), threadCount, [&](unsigned, size_t from, size_t to) {
+            for (uint64_t prime : primes) {
+                if (prime == 2) continue;
+                uint64_t first = std::max(prime * prime, (2 * from + 1 + prime - 1) / prime * prime);
+                if (first % 2 == 0) first += prime;
+                for (uint64_t multiple = first; multiple / 2 < to && multiple <= limit; multiple += 2 * prime) {
+                    if (factors[multiple / 2] == 0) factors[multiple / 2] = (uint32_t) prime;
+                }
+            }
+            for (size_t i = std::max<size_t>(from, 1); i < to; i++) {
+                if (factors[i] == 0) factors[i] = (uint32_t) (2 * i + 1);
+            }
+        });
+    }
+
+    uint32_t limit;
+    Vector<uint32_t> factors; // factors[i] is the smallest prime factor of 2 * i + 1
+};
+
+template<typename Sequence>
+void appendPrimesInRange(int from, int to, Sequence &result) {
+    if (to < 2) return;
+    forEachPrimeInRange((uint64_t) std::max(from, 0), (uint64_t) to, [&](uint64_t prime) {
+        result.push_back((int) prime);
+    });
+}
+
 List<int> listPrimesInRange(int from, int to) {
     List<int> result;
-    for (auto n : range(from, to)) {
-        if (isPrime(n)) result.push_back(n);
-    }
+    appendPrimesInRange(from, to, result);
+    return result;
+}
+
+std::pmr::list<int> listPrimesInRange(int from, int to, std::pmr::memory_resource *resource) {
+    std::pmr::list<int> result(resource);
+    appendPrimesInRange(from, to, result);
     return result;
 }
 